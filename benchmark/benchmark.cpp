@@ -0,0 +1,399 @@
+// Benchmark suite for the Fast Poisson Disk Sampling implementation.
+// Sweeps domain size, 'r' and 'k' for the 2D and 3D samplers and reports throughput, memory and attempt counts as JSON
+// on standard output, so results can be diffed between revisions to catch regressions.
+//
+// Usage: fpds-bench [--quick | --large] [--repetitions <count>] [--filter <2|3>] [--seed <value>]
+//                   [--generator <name>] [--policy <name>] [--storage <name>] [--simd <level>] [--threads <count>]
+//                   [--engine <name>] [--verify]
+// Generators: xoshiro128 (default), philox, mt19937.
+// Policies: random (default), fifo, lifo, bucketed, all. The '--large' sweep generates 10M+ points per run, to expose
+// the memory locality of each active list policy.
+// Storage: index (default), coordinates.
+// SIMD levels: scalar, avx2, avx512 (default: widest supported by the host CPU).
+// Threads: 0 (default) runs the sequential samplers, any other count the parallel samplers of the chosen engine.
+// Engines: tiled (default, fast_poisson_disk_parallel_*), concurrent (fast_poisson_disk_concurrent_*).
+// '--verify' also checks that every parallel configuration generates the same points on one thread as on '--threads'
+// threads, and exits with status 1 if any does not. Only the tiled engine is reproducible, so '--verify' is rejected with
+// '--engine concurrent'. The test suite (ctest) checks the tiled engine over several thread counts.
+
+#include "fpds.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+namespace {
+
+    struct configuration {
+        int dimension;
+        float size; // Side length of the (square / cubic) sampling domain.
+        float r;
+        int k;
+        std::string policy;
+        std::string storage;
+        unsigned threads;
+        std::string engine;
+    };
+
+    struct result {
+        configuration config;
+        std::size_t points;
+        double seconds; // Median over all repetitions.
+        double attempts_per_point;
+        long peak_rss_kb;
+        int reproducible; // 1 or 0 if verified, -1 otherwise.
+    };
+
+    // Resets the peak resident set size of the process, where supported (Linux 4.0+), so each configuration reports
+    // its own high-water mark. Otherwise the reported value is the high-water mark of the process so far.
+    void reset_peak_rss() {
+#if defined(__GLIBC__)
+        // Hand the memory freed by earlier configurations (including the arenas of their worker threads) back to the
+        // system first, so that it does not count towards the next high-water mark.
+        malloc_trim(0);
+#endif
+#if defined(__linux__)
+        if (FILE* file = std::fopen("/proc/self/clear_refs", "w")) {
+            std::fputs("5", file);
+            std::fclose(file);
+        }
+#endif
+    }
+
+    // On Linux, the high-water mark is read from 'VmHWM', which 'reset_peak_rss' clears. getrusage() is not reset by
+    // it, and also folds in the peaks of exited threads (such as the pools of earlier parallel configurations).
+    long peak_rss_kb() {
+#if defined(__linux__)
+        if (FILE* file = std::fopen("/proc/self/status", "r")) {
+            char line[256];
+            long kilobytes = -1;
+            while (std::fgets(line, sizeof(line), file)) {
+                if (std::sscanf(line, "VmHWM: %ld kB", &kilobytes) == 1) {
+                    break;
+                }
+            }
+            std::fclose(file);
+            if (kilobytes >= 0) {
+                return kilobytes;
+            }
+        }
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+        rusage usage { };
+        getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+        return usage.ru_maxrss / 1024; // Reported in bytes.
+#else
+        return usage.ru_maxrss; // Reported in kilobytes.
+#endif
+#else
+        return -1;
+#endif
+    }
+
+    // FNV-1a hash of the bit patterns of every coordinate, in output order.
+    template <typename Points>
+    std::uint64_t digest(const Points& points) {
+        std::uint64_t hash = 14695981039346656037ull;
+        for (const auto& point : points) {
+            const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&point);
+            for (std::size_t i = 0; i < sizeof(point); ++i) {
+                hash = (hash ^ bytes[i]) * 1099511628211ull;
+            }
+        }
+        return hash;
+    }
+
+    // Returns the number of points generated, and stores a digest of them in 'hash' if given.
+    template <typename Points>
+    std::size_t summarize(const Points& points, std::uint64_t* hash) {
+        if (hash) {
+            *hash = digest(points);
+        }
+        return points.size();
+    }
+
+    template <typename Policy, typename Storage, typename URBG>
+    std::size_t run(const configuration& config, URBG& generator, fpds::statistics& stats, std::uint64_t* hash) {
+        fpds::vec2 square { config.size, config.size };
+        fpds::vec3 cube { config.size, config.size, config.size };
+
+        if (config.threads && config.engine == "concurrent") {
+            if (config.dimension == 2) {
+                return summarize(fpds::fast_poisson_disk_concurrent_2d(square, config.r, config.k, generator, config.threads, &stats), hash);
+            }
+            return summarize(fpds::fast_poisson_disk_concurrent_3d(cube, config.r, config.k, generator, config.threads, &stats), hash);
+        }
+        if (config.threads) {
+            if (config.dimension == 2) {
+                return summarize(fpds::fast_poisson_disk_parallel_2d<Policy>(square, config.r, config.k, generator, config.threads, &stats), hash);
+            }
+            return summarize(fpds::fast_poisson_disk_parallel_3d<Policy>(cube, config.r, config.k, generator, config.threads, &stats), hash);
+        }
+        if (config.dimension == 2) {
+            return summarize(fpds::fast_poisson_disk_2d<Policy, Storage>(square, config.r, config.k, generator, &stats), hash);
+        }
+        return summarize(fpds::fast_poisson_disk_3d<Policy, Storage>(cube, config.r, config.k, generator, &stats), hash);
+    }
+
+    template <typename Policy, typename URBG>
+    std::size_t run(const configuration& config, URBG& generator, fpds::statistics& stats, std::uint64_t* hash) {
+        if (config.storage == "coordinates") {
+            return run<Policy, fpds::coordinate_storage>(config, generator, stats, hash);
+        }
+        return run<Policy, fpds::index_storage>(config, generator, stats, hash);
+    }
+
+    template <typename URBG>
+    std::size_t run(const configuration& config, URBG& generator, fpds::statistics& stats, std::uint64_t* hash) {
+        if (config.policy == "fifo") {
+            return run<fpds::fifo_selection>(config, generator, stats, hash);
+        }
+        if (config.policy == "lifo") {
+            return run<fpds::lifo_selection>(config, generator, stats, hash);
+        }
+        if (config.policy == "bucketed") {
+            return run<fpds::bucketed_selection>(config, generator, stats, hash);
+        }
+        return run<fpds::random_selection>(config, generator, stats, hash);
+    }
+
+    // Runs a single sampling pass, returning the number of points generated.
+    std::size_t run(const configuration& config, const std::string& generator, std::uint32_t seed, fpds::statistics& stats,
+                    std::uint64_t* hash = nullptr) {
+        if (generator == "philox") {
+            fpds::philox philox { seed };
+            return run(config, philox, stats, hash);
+        }
+        if (generator == "mt19937") {
+            std::mt19937 mt19937 { seed };
+            return run(config, mt19937, stats, hash);
+        }
+        fpds::xoshiro128 xoshiro128 { seed };
+        return run(config, xoshiro128, stats, hash);
+    }
+
+    // Every repetition uses the same seed, so repetitions (and separate invocations) perform identical work.
+    result measure(const configuration& config, int repetitions, const std::string& generator, std::uint32_t seed) {
+        std::vector<double> timings;
+        std::size_t points = 0;
+        std::size_t candidates = 0;
+
+        reset_peak_rss();
+
+        for (int i = 0; i < repetitions; ++i) {
+            fpds::statistics stats;
+
+            auto start = std::chrono::steady_clock::now();
+            points = run(config, generator, seed, stats);
+            auto end = std::chrono::steady_clock::now();
+
+            timings.push_back(std::chrono::duration<double>(end - start).count());
+            candidates = stats.candidates;
+        }
+
+        std::sort(timings.begin(), timings.end());
+
+        result r { };
+        r.config = config;
+        r.points = points;
+        r.seconds = timings[timings.size() / 2];
+        r.attempts_per_point = points ? static_cast<double>(candidates) / static_cast<double>(points) : 0.0;
+        r.peak_rss_kb = peak_rss_kb();
+        r.reproducible = -1;
+        return r;
+    }
+
+    // Returns whether a parallel configuration generates the same points on a single thread as on 'config.threads'.
+    bool reproducible(const configuration& config, const std::string& generator, std::uint32_t seed) {
+        configuration single = config;
+        single.threads = 1;
+
+        fpds::statistics stats;
+        std::uint64_t expected = 0;
+        std::uint64_t actual = 0;
+
+        run(single, generator, seed, stats, &expected);
+        run(config, generator, seed, stats, &actual);
+        return expected == actual;
+    }
+
+    std::vector<configuration> sweep(bool quick, bool large, const std::string& policy, const std::string& storage, unsigned threads,
+                                     const std::string& engine) {
+        std::vector<float> sizes_2d = { 128.0f, 512.0f, 2048.0f };
+        std::vector<float> sizes_3d = { 16.0f, 32.0f, 64.0f };
+        std::vector<float> radii = { 1.0f, 2.0f };
+        std::vector<int> limits = { 10, 30 };
+
+        if (quick) {
+            sizes_2d = { 128.0f, 512.0f };
+            sizes_3d = { 16.0f, 32.0f };
+        }
+        else if (large) {
+            sizes_2d = { 4096.0f };
+            sizes_3d = { 256.0f };
+            radii = { 1.0f };
+            limits = { 30 };
+        }
+
+        std::vector<std::string> policies = { policy };
+        if (policy == "all") {
+            policies = { "random", "fifo", "lifo", "bucketed" };
+        }
+
+        std::vector<configuration> configurations;
+        for (int dimension = 2; dimension <= 3; ++dimension) {
+            for (float size : dimension == 2 ? sizes_2d : sizes_3d) {
+                for (float r : radii) {
+                    for (int k : limits) {
+                        for (const std::string& name : policies) {
+                            // The parallel samplers always store coordinates in the grid.
+                            configurations.push_back({ dimension, size, r, k, name, threads ? "coordinates" : storage, threads, engine });
+                        }
+                    }
+                }
+            }
+        }
+        return configurations;
+    }
+
+    const char* simd_level_name(fpds::simd_level level) {
+        switch (level) {
+            case fpds::simd_level::avx512:
+                return "avx512";
+            case fpds::simd_level::avx2:
+                return "avx2";
+            case fpds::simd_level::scalar:
+                break;
+        }
+        return "scalar";
+    }
+
+    void print(const std::vector<result>& results, int repetitions, const std::string& generator, std::uint32_t seed) {
+        std::printf("{\n");
+        std::printf("  \"benchmark\": \"fpds\",\n");
+        std::printf("  \"repetitions\": %d,\n", repetitions);
+        std::printf("  \"generator\": \"%s\",\n", generator.c_str());
+        std::printf("  \"seed\": %u,\n", seed);
+        std::printf("  \"simd\": \"%s\",\n", simd_level_name(fpds::active_simd_level()));
+        std::printf("  \"results\": [\n");
+
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            const result& r = results[i];
+            double points_per_second = r.seconds > 0.0 ? static_cast<double>(r.points) / r.seconds : 0.0;
+            double ns_per_point = r.points ? r.seconds * 1e9 / static_cast<double>(r.points) : 0.0;
+
+            std::printf("    { \"function\": \"fast_poisson_disk_%s%dd\", \"policy\": \"%s\", \"storage\": \"%s\", \"threads\": %u, "
+                        "\"size\": %g, \"r\": %g, \"k\": %d, \"points\": %zu, \"seconds\": %.6f, \"points_per_second\": %.1f, \"ns_per_point\": %.2f, "
+                        "\"attempts_per_point\": %.3f, \"peak_rss_kb\": %ld%s }%s\n",
+                        r.config.threads ? (r.config.engine == "concurrent" ? "concurrent_" : "parallel_") : "", r.config.dimension, r.config.policy.c_str(), r.config.storage.c_str(), r.config.threads,
+                        static_cast<double>(r.config.size), static_cast<double>(r.config.r), r.config.k,
+                        r.points, r.seconds, points_per_second, ns_per_point,
+                        r.attempts_per_point, r.peak_rss_kb,
+                        r.reproducible < 0 ? "" : r.reproducible ? ", \"reproducible\": true" : ", \"reproducible\": false",
+                        i + 1 < results.size() ? "," : "");
+        }
+
+        std::printf("  ]\n");
+        std::printf("}\n");
+    }
+
+}
+
+int main(int argc, char** argv) {
+    bool quick = false;
+    bool large = false;
+    int repetitions = 3;
+    int filter = 0; // Dimension to restrict the sweep to, or 0 for all.
+    std::uint32_t seed = 1;
+    std::string generator = "xoshiro128";
+    std::string policy = "random";
+    std::string storage = "index";
+    unsigned threads = 0;
+    std::string engine = "tiled";
+    bool verify = false;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--quick") == 0) {
+            quick = true;
+        }
+        else if (std::strcmp(argv[i], "--large") == 0) {
+            large = true;
+        }
+        else if (std::strcmp(argv[i], "--repetitions") == 0 && i + 1 < argc) {
+            repetitions = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--generator") == 0 && i + 1 < argc) {
+            generator = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--policy") == 0 && i + 1 < argc) {
+            policy = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--storage") == 0 && i + 1 < argc) {
+            storage = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--simd") == 0 && i + 1 < argc) {
+            std::string level = argv[++i];
+            fpds::limit_simd_level(level == "scalar" ? fpds::simd_level::scalar :
+                                   level == "avx2" ? fpds::simd_level::avx2 : fpds::simd_level::avx512);
+        }
+        else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--engine") == 0 && i + 1 < argc) {
+            engine = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--verify") == 0) {
+            verify = true;
+        }
+        else {
+            std::fprintf(stderr, "usage: %s [--quick | --large] [--repetitions <count>] [--filter <2|3>] [--seed <value>] "
+                                 "[--generator <xoshiro128|philox|mt19937>] [--policy <random|fifo|lifo|bucketed|all>] "
+                                 "[--storage <index|coordinates>] [--simd <scalar|avx2|avx512>] [--threads <count>] "
+                                 "[--engine <tiled|concurrent>] [--verify]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (verify && engine == "concurrent") {
+        std::fprintf(stderr, "%s: --verify requires the tiled engine; the concurrent engine depends on scheduling\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<result> results;
+    int failures = 0;
+    for (const configuration& config : sweep(quick, large, policy, storage, threads, engine)) {
+        if (filter && config.dimension != filter) {
+            continue;
+        }
+        results.push_back(measure(config, repetitions, generator, seed));
+
+        if (verify && config.threads) {
+            results.back().reproducible = reproducible(config, generator, seed);
+            failures += !results.back().reproducible;
+        }
+    }
+
+    print(results, repetitions, generator, seed);
+    return failures ? 1 : 0;
+}
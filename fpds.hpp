@@ -1,13 +1,63 @@
-
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <queue>
+#include <limits>
+#include <list>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
 #include <vector>
 #include <cmath>
 #include <random>
+#include <string>
 
 #define PI 3.1415926535897932384626433f
 #define NO_SAMPLE -1
 
+// Vectorized candidate evaluation (AVX2 / AVX-512, selected at runtime) is available with GCC and Clang on x86.
+// Define FPDS_DISABLE_SIMD to always use the scalar path.
+#if !defined(FPDS_DISABLE_SIMD) && (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define FPDS_X86_SIMD 1
+#include <immintrin.h>
+#else
+#define FPDS_X86_SIMD 0
+#endif
+
+// Point set files are memory-mapped on POSIX systems, and read into memory elsewhere.
+#if defined(__unix__) || defined(__APPLE__)
+#define FPDS_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define FPDS_MMAP 0
+#endif
+
+// The sampling loop is shared by one-shot calls and reusable samplers. It is forced inline so that one-shot calls keep
+// their grid local, where the compiler knows that writes to the output list leave it untouched (measurable with
+// AVX-512).
+#if defined(__GNUC__) || defined(__clang__)
+#define FPDS_INLINE inline __attribute__((always_inline))
+#else
+#define FPDS_INLINE inline
+#endif
+
 namespace fpds {
 
     // Utility functionality + helper classes.
@@ -46,346 +96,4527 @@ namespace fpds {
         int z;
     };
 
-    [[nodiscard]] float distance2(const vec2& a, const vec2& b) {
+    // N-dimensional point in world space, used by the dimension-generic implementation.
+    template <std::size_t N>
+    using point = std::array<float, N>;
+
+    // N-dimensional cell coordinate in grid space.
+    template <std::size_t N>
+    using cell = std::array<int, N>;
+
+    [[nodiscard]] inline float distance2(const vec2& a, const vec2& b) {
         return (a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y);
     }
 
-    [[nodiscard]] float distance2(const vec3& a, const vec3& b) {
+    [[nodiscard]] inline float distance2(const vec3& a, const vec3& b) {
         return (a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y) + (a.z - b.z) * (a.z - b.z);
     }
 
-    [[nodiscard]] int uniform_int_distribution(int min, int max) {
-        static std::random_device device;
-        static std::default_random_engine generator(device());
-        std::uniform_int_distribution<int> distribution(min, max);
-
-        return distribution(generator);
+    template <std::size_t N>
+    [[nodiscard]] float distance2(const point<N>& a, const point<N>& b) {
+        float result = 0.0f;
+        for (std::size_t i = 0; i < N; ++i) {
+            result += (a[i] - b[i]) * (a[i] - b[i]);
+        }
+        return result;
     }
 
-    [[nodiscard]] float uniform_real_distribution(float min, float max) {
-        static std::random_device device;
-        static std::default_random_engine generator(device());
-        std::uniform_real_distribution<float> distribution(min, max);
+    namespace detail {
 
-        return distribution(generator);
-    }
+        // True for types satisfying the UniformRandomBitGenerator requirements ('result_type', 'min()', 'max()' and
+        // 'operator()'). Used to tell generator arguments apart from the optional trailing parameters.
+        template <typename T, typename = void>
+        struct is_uniform_random_bit_generator : std::false_type { };
 
-    struct grid {
-        grid(const vec2& dimensions, float separation_distance)
-                : cell_size(separation_distance / sqrtf(2.0f)),
-                  grid_width(static_cast<int>(std::ceil(dimensions.x / cell_size))),
-                  grid_height(static_cast<int>(std::ceil(dimensions.y / cell_size))),
-                  grid_depth(-1), // Unused for a 2-dimensional grid.
-                  grid_size(grid_width * grid_height),
-                  grid_data(grid_size) {
-            for (int i = 0; i < grid_size; ++i) {
-                grid_data[i] = NO_SAMPLE;
+        template <typename T>
+        struct is_uniform_random_bit_generator<T, std::void_t<typename T::result_type,
+                                                              decltype(T::min()),
+                                                              decltype(T::max()),
+                                                              decltype(std::declval<T&>()())>>
+                : std::is_unsigned<typename T::result_type> { };
+
+        template <typename URBG>
+        using enable_if_generator = std::enable_if_t<is_uniform_random_bit_generator<URBG>::value>;
+
+        // True for output iterators accepting values of type T.
+        template <typename Sink, typename T, typename = void>
+        struct is_output_iterator : std::false_type { };
+
+        template <typename Sink, typename T>
+        struct is_output_iterator<Sink, T, std::void_t<decltype(*std::declval<Sink&>() = std::declval<const T&>()),
+                                                       decltype(++std::declval<Sink&>())>>
+                : std::true_type { };
+
+        // Sample sinks are callbacks taking a sample, or output iterators accepting samples.
+        template <typename Sink, typename T>
+        using enable_if_sink = std::enable_if_t<std::is_invocable_v<Sink&, const T&> || is_output_iterator<Sink, T>::value>;
+
+        template <typename Sink, typename T>
+        void emit_to(Sink& sink, const T& sample) {
+            if constexpr (std::is_invocable_v<Sink&, const T&>) {
+                sink(sample);
+            }
+            else {
+                *sink = sample;
+                ++sink;
             }
         }
 
-        grid(const vec3& dimensions, float separation_distance)
-                : cell_size(separation_distance / sqrtf(2.0f)),
-                  grid_width(static_cast<int>(std::ceil(dimensions.x / cell_size))),
-                  grid_height(static_cast<int>(std::ceil(dimensions.y / cell_size))),
-                  grid_depth(static_cast<int>(std::ceil(dimensions.z / cell_size))),
-                  grid_size(grid_width * grid_height * grid_depth),
-                  grid_data(grid_size) {
-            for (int i = 0; i < grid_size; ++i) {
-                grid_data[i] = NO_SAMPLE;
+        // True for generators producing every value of a result type at least 32 bits wide, whose output bits can be
+        // used directly without going through a standard distribution object.
+        template <typename URBG>
+        constexpr bool has_full_range_bits = URBG::min() == 0 &&
+                                             URBG::max() == std::numeric_limits<typename URBG::result_type>::max() &&
+                                             std::numeric_limits<typename URBG::result_type>::digits >= 32;
+
+        // Uniformly distributed float in [0, 1).
+        template <typename URBG>
+        [[nodiscard]] float canonical(URBG& generator) {
+            if constexpr (has_full_range_bits<URBG>) {
+                // Top 24 bits map exactly onto the float mantissa.
+                constexpr int shift = std::numeric_limits<typename URBG::result_type>::digits - 24;
+                return static_cast<float>(generator() >> shift) * 0x1.0p-24f;
+            }
+            else {
+                float result = std::generate_canonical<float, std::numeric_limits<float>::digits>(generator);
+                return result < 1.0f ? result : 0x1.fffffep-1f;
             }
         }
 
-        // 2D index into flattened array.
-        [[nodiscard]] int get(int x, int y) const {
-            return grid_data[x + grid_width * y];
+        // Uniformly distributed integer in [0, range).
+        template <typename URBG>
+        [[nodiscard]] std::uint32_t bounded(URBG& generator, std::uint32_t range) {
+            if constexpr (has_full_range_bits<URBG>) {
+                // Multiply-shift range reduction (Lemire), using the top 32 bits of the generator output.
+                constexpr int shift = std::numeric_limits<typename URBG::result_type>::digits - 32;
+                std::uint64_t bits = static_cast<std::uint32_t>(generator() >> shift);
+                return static_cast<std::uint32_t>((bits * range) >> 32);
+            }
+            else {
+                return std::uniform_int_distribution<std::uint32_t>(0, range - 1)(generator);
+            }
         }
 
-        void set(int value, int x, int y) {
-            grid_data[x + grid_width * y] = value;
-        }
+    }
 
-        // 3D index into flattened array.
-        [[nodiscard]] int get(int x, int y, int z) const {
-            return grid_data[x + grid_width * z + grid_width * grid_depth * y];
-        }
+    // Uniformly distributed integer in [min, max], drawn from the given generator.
+    template <typename URBG>
+    [[nodiscard]] int uniform_int_distribution(URBG& generator, int min, int max) {
+        return min + static_cast<int>(detail::bounded(generator, static_cast<std::uint32_t>(max - min) + 1u));
+    }
 
-        void set(int value, int x, int y, int z) {
-            grid_data[x + grid_width * z + grid_width * grid_depth * y] = value;
+    // Uniformly distributed float in [min, max), drawn from the given generator.
+    template <typename URBG>
+    [[nodiscard]] float uniform_real_distribution(URBG& generator, float min, float max) {
+        return min + (max - min) * detail::canonical(generator);
+    }
+
+    namespace detail {
+
+        // Maps the top 23 bits of 'bits' onto a float in [1, 2) by filling the mantissa directly, then shifts the
+        // result into [0, 1). Avoids the integer to float conversion and multiplication of the general path.
+        [[nodiscard]] inline float bits_to_unit_float(std::uint32_t bits) {
+            std::uint32_t representation = UINT32_C(0x3F800000) | (bits >> 9);
+            float result;
+            std::memcpy(&result, &representation, sizeof(float));
+            return result - 1.0f;
         }
 
-        [[nodiscard]] ivec2 convert_to_grid_coordinates(const vec2& world_coordinates) const {
-            return { static_cast<int>(std::floor(world_coordinates.x / cell_size)),
-                     static_cast<int>(std::floor(world_coordinates.y / cell_size)) };
+        [[nodiscard]] inline std::uint64_t splitmix64(std::uint64_t& state) {
+            std::uint64_t z = (state += UINT64_C(0x9E3779B97F4A7C15));
+            z = (z ^ (z >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+            z = (z ^ (z >> 27)) * UINT64_C(0x94D049BB133111EB);
+            return z ^ (z >> 31);
         }
 
-        [[nodiscard]] ivec3 convert_to_grid_coordinates(const vec3& world_coordinates) const {
-            return { static_cast<int>(std::floor(world_coordinates.x / cell_size)),
-                     static_cast<int>(std::floor(world_coordinates.y / cell_size)),
-                     static_cast<int>(std::floor(world_coordinates.z / cell_size)) };
+        [[nodiscard]] inline std::uint32_t rotate_left(std::uint32_t value, int count) {
+            return (value << count) | (value >> (32 - count));
         }
 
-        float cell_size;
+    }
 
-        int grid_width;
-        int grid_height;
-        int grid_depth;
-        int grid_size;
+    // xoshiro128+ generator (Blackman & Vigna), running 'lanes' independent streams side by side. Every lane advances in
+    // lockstep, so block generation is a fixed-width loop over plain arrays that compilers vectorize directly.
+    // Satisfies the UniformRandomBitGenerator requirements.
+    class xoshiro128 {
+        public:
+            using result_type = std::uint32_t;
+
+            static constexpr std::size_t lanes = 8;
+
+            explicit xoshiro128(std::uint64_t seed = 0) : state(), buffer(), position(lanes) {
+                // Expand the seed into every lane with splitmix64, as recommended by the authors.
+                std::uint64_t seed_state = seed;
+                for (std::size_t lane = 0; lane < lanes; ++lane) {
+                    std::uint64_t low = detail::splitmix64(seed_state);
+                    std::uint64_t high = detail::splitmix64(seed_state);
 
-        std::vector<int> grid_data;
+                    state[0][lane] = static_cast<std::uint32_t>(low);
+                    state[1][lane] = static_cast<std::uint32_t>(low >> 32);
+                    state[2][lane] = static_cast<std::uint32_t>(high);
+                    state[3][lane] = static_cast<std::uint32_t>(high >> 32);
+                }
+            }
+
+            [[nodiscard]] static constexpr result_type min() {
+                return 0;
+            }
+
+            [[nodiscard]] static constexpr result_type max() {
+                return std::numeric_limits<result_type>::max();
+            }
+
+            result_type operator()() {
+                if (position == lanes) {
+                    next(buffer.data());
+                    position = 0;
+                }
+                return buffer[position++];
+            }
+
+            // Fills 'output' with 'count' uniformly distributed floats in [0, 1).
+            void fill_uniform(float* output, std::size_t count) {
+                std::size_t i = 0;
+
+                // Consume values left over from scalar draws first, so both interfaces share one stream.
+                for (; i < count && position < lanes; ++i) {
+                    output[i] = detail::bits_to_unit_float(buffer[position++]);
+                }
+
+                std::array<std::uint32_t, lanes> bits;
+                for (; i + lanes <= count; i += lanes) {
+                    next(bits.data());
+                    for (std::size_t lane = 0; lane < lanes; ++lane) {
+                        output[i + lane] = detail::bits_to_unit_float(bits[lane]);
+                    }
+                }
+
+                for (; i < count; ++i) {
+                    output[i] = detail::bits_to_unit_float((*this)());
+                }
+            }
+
+        private:
+            // Advances every lane once, writing one output per lane.
+            void next(std::uint32_t* output) {
+                for (std::size_t lane = 0; lane < lanes; ++lane) {
+                    output[lane] = state[0][lane] + state[3][lane];
+
+                    std::uint32_t t = state[1][lane] << 9;
+
+                    state[2][lane] ^= state[0][lane];
+                    state[3][lane] ^= state[1][lane];
+                    state[1][lane] ^= state[2][lane];
+                    state[0][lane] ^= state[3][lane];
+
+                    state[2][lane] ^= t;
+                    state[3][lane] = detail::rotate_left(state[3][lane], 11);
+                }
+            }
+
+            std::array<std::array<std::uint32_t, lanes>, 4> state; // Structure of arrays: state word, then lane.
+            std::array<std::uint32_t, lanes> buffer;
+            std::size_t position;
     };
 
+    // Philox4x32-10 counter-based generator (Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3").
+    // Output block 'i' of stream 's' is a pure function of (key, s, i), so independent streams (e.g. one per tile or
+    // thread) are reproducible without sharing or advancing any sequential state. Satisfies the
+    // UniformRandomBitGenerator requirements.
+    class philox {
+        public:
+            using result_type = std::uint32_t;
 
+            explicit philox(std::uint64_t seed = 0, std::uint64_t stream = 0)
+                    : key { static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(seed >> 32) },
+                      stream(stream),
+                      counter(0),
+                      buffer(),
+                      position(4) {
+            }
 
-    // Fast Poisson Disk Sampling algorithm, for 2D applications.
-    // 'r' - minimum distance to be maintained between final point samples.
-    // 'k' - limit of samples to try before sample rejection (defaulted at 30, provided by the paper).
-    [[nodiscard]] std::vector<vec2> fast_poisson_disk_2d(vec2 dimensions, float r, int k = 30) {
-        grid g { dimensions, r };
+            [[nodiscard]] static constexpr result_type min() {
+                return 0;
+            }
 
-        std::vector<int> active_list;
-        std::vector<vec2> point_list;
+            [[nodiscard]] static constexpr result_type max() {
+                return std::numeric_limits<result_type>::max();
+            }
 
-        // Generate initial sample, randomly chosen uniformly from the given domain.
-        // Sample is in world coordinates.
-        vec2 sample_world_coordinates = vec2(uniform_real_distribution(0.0f, dimensions.x),
-                                             uniform_real_distribution(0.0f, dimensions.y));
+            // Four 32-bit outputs for the given counter, independent of any generator state.
+            [[nodiscard]] static std::array<std::uint32_t, 4> block(std::uint64_t counter, std::uint64_t stream, std::array<std::uint32_t, 2> key) {
+                std::array<std::uint32_t, 4> x { static_cast<std::uint32_t>(counter), static_cast<std::uint32_t>(counter >> 32),
+                                                 static_cast<std::uint32_t>(stream), static_cast<std::uint32_t>(stream >> 32) };
 
-        // Record sample in grid.
-        int sample_index = 0;
-        ivec2 sample_grid_coordinates = g.convert_to_grid_coordinates(sample_world_coordinates);
-        g.set(sample_index, sample_grid_coordinates.x, sample_grid_coordinates.y);
+                for (int round = 0; round < 10; ++round) {
+                    std::uint64_t product0 = static_cast<std::uint64_t>(UINT32_C(0xD2511F53)) * x[0];
+                    std::uint64_t product1 = static_cast<std::uint64_t>(UINT32_C(0xCD9E8D57)) * x[2];
 
-        point_list.emplace_back(sample_world_coordinates);
-        active_list.emplace_back(sample_index);
+                    x = { static_cast<std::uint32_t>(product1 >> 32) ^ x[1] ^ key[0], static_cast<std::uint32_t>(product1),
+                          static_cast<std::uint32_t>(product0 >> 32) ^ x[3] ^ key[1], static_cast<std::uint32_t>(product0) };
 
-        ++sample_index;
+                    key[0] += UINT32_C(0x9E3779B9);
+                    key[1] += UINT32_C(0xBB67AE85);
+                }
 
-        while (!active_list.empty()) {
-            // Choose random index from active sample list.
-            int index = uniform_int_distribution(0, (int) active_list.size() - 1);
-            sample_world_coordinates = point_list[index];
+                return x;
+            }
 
-            bool found_sample = false;
+            result_type operator()() {
+                if (position == 4) {
+                    buffer = block(counter++, stream, key);
+                    position = 0;
+                }
+                return buffer[position++];
+            }
 
-            // Try up to 'k' times to find a valid point.
-            for (int i = 0; i < k; ++i) {
-                // Uniformly generate test points between 'r' and '2r' distance away around the chosen point.
-                float radians = uniform_real_distribution(0.0f, 2.0f * PI);
-                float radius = uniform_real_distribution(r, 2.0f * r);
+            // Fills 'output' with 'count' uniformly distributed floats in [0, 1).
+            void fill_uniform(float* output, std::size_t count) {
+                std::size_t i = 0;
 
-                vec2 test_sample_world_coordinates = vec2(sample_world_coordinates.x + radius * cosf(radians),
-                                                          sample_world_coordinates.y + radius * sinf(radians));
+                for (; i < count && position < 4; ++i) {
+                    output[i] = detail::bits_to_unit_float(buffer[position++]);
+                }
 
-                // Ensure offsetting point did not push it out of bounds.
-                if (test_sample_world_coordinates.x < 0.0f || test_sample_world_coordinates.x >= dimensions.x) {
-                    continue;
+                // Blocks are independent of each other, so this loop carries no dependency between iterations.
+                for (; i + 4 <= count; i += 4) {
+                    std::array<std::uint32_t, 4> bits = block(counter++, stream, key);
+                    for (std::size_t j = 0; j < 4; ++j) {
+                        output[i + j] = detail::bits_to_unit_float(bits[j]);
+                    }
                 }
-                if (test_sample_world_coordinates.y < 0.0f || test_sample_world_coordinates.y >= dimensions.y) {
-                    continue;
+
+                for (; i < count; ++i) {
+                    output[i] = detail::bits_to_unit_float((*this)());
                 }
+            }
 
-                ivec2 test_sample_grid_coordinates = g.convert_to_grid_coordinates(test_sample_world_coordinates);
+            // Repositions the generator at the start of output block 'block_index' of its stream.
+            void seek(std::uint64_t block_index) {
+                counter = block_index;
+                position = 4;
+            }
 
-                // Don't override cells that already have samples in them.
-                int test_sample_index = g.get(test_sample_grid_coordinates.x, test_sample_grid_coordinates.y);
-                if (test_sample_index != NO_SAMPLE) {
-                    continue;
+        private:
+            std::array<std::uint32_t, 2> key;
+            std::uint64_t stream;
+            std::uint64_t counter;
+
+            std::array<std::uint32_t, 4> buffer;
+            std::size_t position;
+    };
+
+    namespace detail {
+
+        template <typename T, typename = void>
+        struct has_fill_uniform : std::false_type { };
+
+        template <typename T>
+        struct has_fill_uniform<T, std::void_t<decltype(std::declval<T&>().fill_uniform(std::declval<float*>(), std::size_t { }))>>
+                : std::true_type { };
+
+        // Serves uniform floats to the sampling loop from a block refilled in bulk, through 'fill_uniform' for
+        // generators that provide it (fpds::xoshiro128, fpds::philox) or one draw at a time otherwise.
+        template <typename URBG>
+        class random_stream {
+            public:
+                explicit random_stream(URBG& generator) : generator(generator), block(), position(block_size) {
+                }
+
+                // Uniformly distributed float in [min, max).
+                [[nodiscard]] float uniform(float min, float max) {
+                    if (position == block_size) {
+                        refill();
+                    }
+                    return min + (max - min) * block[position++];
                 }
 
-                bool valid_sample = true;
+                // Uniformly distributed integer in [0, count).
+                [[nodiscard]] int index(int count) {
+                    return static_cast<int>(bounded(generator, static_cast<std::uint32_t>(count)));
+                }
 
-                // Check grid cells directly adjacent to the test cell to ensure the validity of the selected sample.
-                for (int y = -1; y < 2; ++y) {
-                    for (int x = -1; x < 2; ++x) {
-                        if (x == 0 && y == 0) {
-                            continue;
+            private:
+                void refill() {
+                    if constexpr (has_fill_uniform<URBG>::value) {
+                        generator.fill_uniform(block.data(), block_size);
+                    }
+                    else {
+                        for (float& value : block) {
+                            value = canonical(generator);
                         }
+                    }
+                    position = 0;
+                }
 
-                        int x_offset = test_sample_grid_coordinates.x + x;
-                        int y_offset = test_sample_grid_coordinates.y + y;
+                static constexpr std::size_t block_size = 64;
 
-                        // Ensure desired offset into the grid is in range.
-                        if (x_offset < 0 || x_offset >= g.grid_width) {
-                            continue;
-                        }
-                        if (y_offset < 0 || y_offset >= g.grid_height) {
-                            continue;
-                        }
+                URBG& generator;
+                std::array<float, block_size> block;
+                std::size_t position;
+        };
+
+    }
 
-                        // Offset from current point.
-                        test_sample_index = g.get(x_offset, y_offset);
+    namespace detail {
 
-                        if (test_sample_index != NO_SAMPLE) {
-                            // Found existing sample in the checked grid cell.
-                            // Selected sample may still be valid if the separation between the existing and selected
-                            // samples is adequately far.
-                            const vec2& existing_sample = point_list[test_sample_index];
+        // With cells of side r / sqrt(N), a cell 'offset' cells away from another (per axis) can only hold a conflicting
+        // sample if sum(max(|offset| - 1, 0)^2) < N, i.e. if the minimum distance between the two cells is below 'r'.
+        // This is an exact integer test, independent of 'r'.
+        [[nodiscard]] constexpr int conflict_distance2(int offset) {
+            int gap = (offset < 0 ? -offset : offset) - 1;
+            return gap > 0 ? gap * gap : 0;
+        }
 
-                            // Ensure separation between current and test point is at least 'r'.
-                            if (distance2(existing_sample, test_sample_world_coordinates) < r * r) {
-                                valid_sample = false;
-                                break;
-                            }
-                        }
+        // Largest per-axis offset at which a cell can still conflict with the center cell.
+        [[nodiscard]] constexpr int stencil_reach(std::size_t N) {
+            int reach = 1;
+            while (conflict_distance2(reach + 1) < static_cast<int>(N)) {
+                ++reach;
+            }
+            return reach;
+        }
+
+        // Offsets of exactly the cells whose minimum distance to the center cell is below 'r' (excluding the center cell
+        // itself), ordered nearest-first so that conflicts are usually found within the first few cells visited.
+        // Generated once per dimension on first use; enumerating the candidate offsets at compile time exceeds constant
+        // evaluation limits for the higher dimensions (up to 7^8 offsets in 8D).
+        template <std::size_t N>
+        [[nodiscard]] const std::vector<cell<N>>& conflict_stencil() {
+            static const std::vector<cell<N>> stencil = [] {
+                constexpr int reach = stencil_reach(N);
+                constexpr int width = 2 * reach + 1;
+
+                struct entry {
+                    cell<N> offset;
+                    int minimum_distance2; // Squared minimum distance between the cells, in cell units.
+                    int center_distance2;  // Squared distance between the cell centers, in cell units.
+                };
+
+                std::vector<entry> entries;
+
+                int total = 1;
+                for (std::size_t axis = 0; axis < N; ++axis) {
+                    total *= width;
+                }
+
+                for (int i = 0; i < total; ++i) {
+                    entry e { { }, 0, 0 };
+
+                    int remainder = i;
+                    for (std::size_t axis = 0; axis < N; ++axis) {
+                        e.offset[axis] = remainder % width - reach;
+                        e.minimum_distance2 += conflict_distance2(e.offset[axis]);
+                        e.center_distance2 += e.offset[axis] * e.offset[axis];
+                        remainder /= width;
+                    }
+
+                    if (e.center_distance2 != 0 && e.minimum_distance2 < static_cast<int>(N)) {
+                        entries.push_back(e);
                     }
                 }
 
-                if (valid_sample) {
-                    // Record sample in grid.
-                    g.set(sample_index, test_sample_grid_coordinates.x, test_sample_grid_coordinates.y);
+                std::stable_sort(entries.begin(), entries.end(), [](const entry& a, const entry& b) {
+                    if (a.minimum_distance2 != b.minimum_distance2) {
+                        return a.minimum_distance2 < b.minimum_distance2;
+                    }
+                    return a.center_distance2 < b.center_distance2;
+                });
 
-                    point_list.emplace_back(test_sample_world_coordinates);
-                    active_list.emplace_back(sample_index);
+                std::vector<cell<N>> offsets;
+                offsets.reserve(entries.size());
+                for (const entry& e : entries) {
+                    offsets.push_back(e.offset);
+                }
+                return offsets;
+            }();
 
-                    ++sample_index;
+            return stencil;
+        }
 
-                    found_sample = true;
-                    break;
+        // Offsets of the 3^N - 1 cells sharing a face, edge or corner with the center cell.
+        template <std::size_t N>
+        [[nodiscard]] const std::vector<cell<N>>& adjacent_offsets() {
+            static const std::vector<cell<N>> offsets = [] {
+                std::vector<cell<N>> result;
+
+                int total = 1;
+                for (std::size_t i = 0; i < N; ++i) {
+                    total *= 3;
+                }
+
+                for (int index = 0; index < total; ++index) {
+                    cell<N> offset;
+                    bool center = true;
+
+                    int remainder = index;
+                    for (std::size_t i = 0; i < N; ++i) {
+                        offset[i] = remainder % 3 - 1;
+                        center = center && offset[i] == 0;
+                        remainder /= 3;
+                    }
+
+                    if (!center) {
+                        result.emplace_back(offset);
+                    }
                 }
+                return result;
+            }();
+
+            return offsets;
+        }
+
+        // Uniformly generates a test point between 'r' and '2r' distance away around 'center', in a uniformly distributed
+        // direction. No trigonometric functions are evaluated.
+        template <std::size_t N, typename URBG>
+        [[nodiscard]] point<N> generate_around(random_stream<URBG>& random, const point<N>& center, float r) {
+            float radius = random.uniform(r, 2.0f * r);
+            point<N> result = center;
+
+            // Rejection sampling from the unit disk (accepted 79% of the time), on which the 2D and 3D directions are
+            // built.
+            float u, v, s;
+            do {
+                u = random.uniform(-1.0f, 1.0f);
+                v = random.uniform(-1.0f, 1.0f);
+                s = u * u + v * v;
+            } while (s >= 1.0f || s == 0.0f);
+
+            if constexpr (N == 2) {
+                // The angle of a point uniform within the disk is uniform.
+                float scale = radius / sqrtf(s);
+
+                result[0] += u * scale;
+                result[1] += v * scale;
             }
+            else if constexpr (N == 3) {
+                // Marsaglia's method maps the disk onto the unit sphere uniformly (unlike uniform spherical angles,
+                // which cluster around the poles).
+                float scale = 2.0f * radius * sqrtf(1.0f - s);
 
-            if (!found_sample) {
-                // Failed to find a valid point position after 'k' attempts.
-                // We can say, within a reasonable certainty, that no more points can fit around the chosen point.
-                active_list.erase(active_list.begin() + index);
+                result[0] += u * scale;
+                result[1] += v * scale;
+                result[2] += radius * (1.0f - 2.0f * s);
+            }
+            else {
+                // Normalizing a vector of independent Gaussian variables yields a uniformly distributed direction.
+                // Gaussian variables are generated in pairs with the Marsaglia polar method, from points in the disk.
+                point<N> direction { };
+                float length2 = 0.0f;
+
+                for (std::size_t i = 0; i < N; i += 2) {
+                    if (i > 0) {
+                        do {
+                            u = random.uniform(-1.0f, 1.0f);
+                            v = random.uniform(-1.0f, 1.0f);
+                            s = u * u + v * v;
+                        } while (s >= 1.0f || s == 0.0f);
+                    }
+
+                    float magnitude = sqrtf(-2.0f * logf(s) / s);
+                    direction[i] = u * magnitude;
+                    if (i + 1 < N) {
+                        direction[i + 1] = v * magnitude;
+                    }
+                }
+
+                for (std::size_t i = 0; i < N; ++i) {
+                    length2 += direction[i] * direction[i];
+                }
+
+                float scale = radius / sqrtf(length2);
+                for (std::size_t i = 0; i < N; ++i) {
+                    result[i] += direction[i] * scale;
+                }
             }
+
+            return result;
         }
 
-        return point_list;
     }
 
+    // Grid cell storage modes.
 
+    // Each cell stores the index of its sample in the output list, offset by the 'first_sample' of the grid (lower values,
+    // such as NO_SAMPLE, mark empty cells). Uses 4 bytes per cell, but every occupied neighbor visited costs a second,
+    // random access into the output list.
+    struct index_storage { };
 
-    // Fast Poisson Disk Sampling algorithm, for 3D applications.
-    // 'r' - minimum distance to be maintained between final point samples.
-    // 'k' - limit of samples to try before sample rejection (defaulted at 30, provided by the paper).
-    [[nodiscard]] std::vector<vec3> fast_poisson_disk_3d(vec3 dimensions, float r, int k = 30) {
-        grid g { dimensions, r };
+    // Each cell stores the coordinates of its sample inline (NaN when empty), so visiting a neighbor is a single
+    // contiguous load. Uses 4N bytes per cell. Empty cells need no special casing: any comparison against a NaN distance
+    // is false, so they never conflict. Requires IEEE NaN semantics (no -ffast-math / -ffinite-math-only).
+    struct coordinate_storage { };
 
-        std::vector<int> active_list;
-        std::vector<vec3> point_list;
+    // Background grid used to accelerate spatial lookups, storing up to one sample per cell.
+    // Cells are sized so that their diagonal is 'r', which guarantees that no two samples can occupy the same cell.
+    // The grid is surrounded by a border of permanently empty cells as wide as the conflict stencil, so neighbors of
+    // any cell inside the domain can be visited through precomputed linear offsets, without range checks.
+    template <std::size_t N, typename Storage = index_storage>
+    struct grid {
+        static_assert(N >= 2 && N <= 8, "fpds::grid supports between 2 and 8 dimensions");
+        static_assert(std::is_same_v<Storage, index_storage> || std::is_same_v<Storage, coordinate_storage>,
+                      "fpds::grid storage must be index_storage or coordinate_storage");
 
-        // Generate initial sample, randomly chosen uniformly from the given domain.
-        // Sample is in world coordinates.
-        vec3 sample_world_coordinates = vec3(uniform_real_distribution(0.0f, dimensions.x),
-                                             uniform_real_distribution(0.0f, dimensions.y),
-                                             uniform_real_distribution(0.0f, dimensions.z));
+        static constexpr int grid_padding = detail::stencil_reach(N);
+        static constexpr bool inline_coordinates = std::is_same_v<Storage, coordinate_storage>;
 
-        // Record sample in grid.
-        int sample_index = 0;
-        ivec3 sample_grid_coordinates = g.convert_to_grid_coordinates(sample_world_coordinates);
-        g.set(sample_index, sample_grid_coordinates.x, sample_grid_coordinates.y, sample_grid_coordinates.z);
+        grid(const point<N>& dimensions, float separation_distance) : cell_size(0.0f), grid_dimensions(), grid_strides(), grid_size(0), first_sample(0) {
+            layout(dimensions, separation_distance);
 
-        point_list.emplace_back(sample_world_coordinates);
-        active_list.emplace_back(sample_index);
+            if constexpr (inline_coordinates) {
+                grid_samples.assign(grid_size, empty_cell());
+            }
+            else {
+                grid_data.assign(grid_size, NO_SAMPLE);
+            }
+        }
 
-        ++sample_index;
+        // Empties the grid and lays it out over 'dimensions' (which may differ from the previous domain), reusing its
+        // storage: memory is only allocated if the grid grows. With index storage, emptying takes O(1): 'first_sample' is
+        // raised past the 'recorded' samples stored since the grid was last emptied, so that every stored value reads as
+        // empty, and cells are only cleared again when raising it further could overflow. Coordinate storage has no
+        // room for such a tag, and is refilled.
+        void reset(const point<N>& dimensions, float separation_distance, std::size_t recorded) {
+            layout(dimensions, separation_distance);
 
-        while (!active_list.empty()) {
-            // Choose random index from active sample list.
-            int index = uniform_int_distribution(0, (int) active_list.size() - 1);
-            sample_world_coordinates = point_list[index];
+            if constexpr (inline_coordinates) {
+                grid_samples.assign(grid_size, empty_cell());
+            }
+            else {
+                // Samples of the next run are stored below first_sample + grid_size.
+                long long next = static_cast<long long>(first_sample) + static_cast<long long>(recorded);
+                if (next + grid_size > std::numeric_limits<int>::max()) {
+                    grid_data.assign(grid_size, NO_SAMPLE);
+                    first_sample = 0;
+                }
+                else {
+                    first_sample = static_cast<int>(next);
+                    if (grid_data.size() < static_cast<std::size_t>(grid_size)) {
+                        grid_data.resize(grid_size, NO_SAMPLE);
+                    }
+                }
+            }
+        }
 
-            bool found_sample = false;
+        // N-dimensional index into flattened array, with the first axis varying fastest.
+        // Accepts coordinates in [-grid_padding, grid_dimensions + grid_padding) along each axis.
+        [[nodiscard]] int index(const cell<N>& grid_coordinates) const {
+            int result = 0;
+            for (std::size_t i = 0; i < N; ++i) {
+                result += (grid_coordinates[i] + grid_padding) * grid_strides[i];
+            }
+            return result;
+        }
 
-            // Try up to 'k' times to find a valid point.
-            for (int i = 0; i < k; ++i) {
-                // Uniformly generate test points between 'r' and '2r' distance away around the chosen point.
-                float theta = uniform_real_distribution(0.0f, 2.0f * PI);
-                float phi = uniform_real_distribution(0.0f, PI);
-                float radius = uniform_real_distribution(r, 2.0f * r);
+        // Difference in flattened index between a cell and the cell 'cell_offset' away from it.
+        [[nodiscard]] int offset(const cell<N>& cell_offset) const {
+            int result = 0;
+            for (std::size_t i = 0; i < N; ++i) {
+                result += cell_offset[i] * grid_strides[i];
+            }
+            return result;
+        }
 
-                vec3 test_sample_world_coordinates = vec3(sample_world_coordinates.x + radius * cosf(theta) * sinf(phi),
-                                                          sample_world_coordinates.y + radius * sinf(theta) * sinf(phi),
-                                                          sample_world_coordinates.z + radius * cosf(phi));
+        [[nodiscard]] bool empty(int cell_index) const {
+            if constexpr (inline_coordinates) {
+                return std::isnan(grid_samples[cell_index][0]);
+            }
+            else {
+                return grid_data[cell_index] < first_sample;
+            }
+        }
 
-                // Ensure offsetting point did not push it out of bounds.
-                if (test_sample_world_coordinates.x < 0.0f || test_sample_world_coordinates.x >= dimensions.x) {
-                    continue;
+        // Returns whether any sample recorded in the conflict stencil around 'cell_index' lies closer than 'r' to
+        // 'sample' ('r2' is 'r' squared). 'samples' is the output list the stored indices refer to (index storage only).
+        // Stencil cells before 'first' are assumed to have been checked already.
+        [[nodiscard]] bool conflicts(int cell_index, const point<N>& sample, float r2, const std::vector<point<N>>& samples, std::size_t first = 0) const {
+            for (std::size_t i = first; i < neighbor_offsets.size(); ++i) {
+                int neighbor_offset = neighbor_offsets[i];
+
+                if constexpr (inline_coordinates) {
+                    if (distance2(grid_samples[cell_index + neighbor_offset], sample) < r2) {
+                        return true;
+                    }
                 }
-                if (test_sample_world_coordinates.y < 0.0f || test_sample_world_coordinates.y >= dimensions.y) {
-                    continue;
+                else {
+                    int existing_sample = grid_data[cell_index + neighbor_offset];
+                    if (existing_sample >= first_sample && distance2(samples[existing_sample - first_sample], sample) < r2) {
+                        return true;
+                    }
                 }
-                if (test_sample_world_coordinates.z < 0.0f || test_sample_world_coordinates.z >= dimensions.z) {
-                    continue;
+            }
+            return false;
+        }
+
+        // Records 'sample', which has index 'sample_index' in the output list, in the cell at 'cell_index'.
+        void insert(int cell_index, const point<N>& sample, int sample_index) {
+            if constexpr (inline_coordinates) {
+                grid_samples[cell_index] = sample;
+            }
+            else {
+                grid_data[cell_index] = first_sample + sample_index;
+            }
+        }
+
+        [[nodiscard]] cell<N> convert_to_grid_coordinates(const point<N>& world_coordinates) const {
+            cell<N> result { };
+            for (std::size_t i = 0; i < N; ++i) {
+                result[i] = static_cast<int>(std::floor(world_coordinates[i] / cell_size));
+            }
+            return result;
+        }
+
+        float cell_size;
+
+        cell<N> grid_dimensions; // Number of cells covering the domain along each axis, excluding padding.
+        cell<N> grid_strides;
+        int grid_size;
+
+        // Flattened index offsets of detail::conflict_stencil<N>(), in the same (nearest-first) order.
+        std::vector<int> neighbor_offsets;
+
+        std::vector<int> grid_data;          // Index storage.
+        std::vector<point<N>> grid_samples;  // Coordinate storage.
+
+        int first_sample; // Index storage: value stored for the first sample of the output list (see reset).
+
+        private:
+            [[nodiscard]] static point<N> empty_cell() {
+                point<N> result;
+                result.fill(std::numeric_limits<float>::quiet_NaN());
+                return result;
+            }
+
+            void layout(const point<N>& dimensions, float separation_distance) {
+                cell_size = separation_distance / std::sqrt(static_cast<float>(N));
+                grid_size = 1;
+                for (std::size_t i = 0; i < N; ++i) {
+                    grid_dimensions[i] = static_cast<int>(std::ceil(dimensions[i] / cell_size));
+                    grid_strides[i] = grid_size;
+                    grid_size *= grid_dimensions[i] + 2 * grid_padding;
+                }
+
+                neighbor_offsets.clear();
+                for (const cell<N>& cell_offset : detail::conflict_stencil<N>()) {
+                    neighbor_offsets.push_back(offset(cell_offset));
+                }
+            }
+    };
+
+
+
+    // Instruction sets used to evaluate candidate batches, selected at runtime from the features of the host CPU.
+    enum class simd_level {
+        scalar,
+        avx2,
+        avx512
+    };
+
+    namespace detail {
+
+        // Widest instruction set supported by both the build and the host CPU.
+        [[nodiscard]] inline simd_level detect_simd_level() {
+#if FPDS_X86_SIMD
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx512f")) {
+                return simd_level::avx512;
+            }
+            if (__builtin_cpu_supports("avx2")) {
+                return simd_level::avx2;
+            }
+#endif
+            return simd_level::scalar;
+        }
+
+        [[nodiscard]] inline std::atomic<simd_level>& simd_dispatch() {
+            static std::atomic<simd_level> level { detect_simd_level() };
+            return level;
+        }
+
+        // Number of candidates generated and evaluated together. Every instruction set consumes random numbers in
+        // batches of this size, so the generated points do not depend on the host CPU.
+        constexpr int batch_size = 16;
+
+        // Candidate points in structure of arrays layout, so each axis can be loaded as one vector.
+        template <std::size_t N>
+        struct candidate_batch {
+            alignas(64) std::array<std::array<float, batch_size>, N> coordinates;
+
+            [[nodiscard]] point<N> get(int lane) const {
+                point<N> result;
+                for (std::size_t axis = 0; axis < N; ++axis) {
+                    result[axis] = coordinates[axis][lane];
                 }
+                return result;
+            }
+        };
+
+        // Evaluates candidates in [begin, count) one at a time, returning the first valid lane or -1.
+        template <std::size_t N, typename Storage>
+        [[nodiscard]] int first_valid_scalar(const grid<N, Storage>& g, const candidate_batch<N>& batch, int begin, int count,
+                                             const point<N>& lower, const point<N>& upper, float r2, const std::vector<point<N>>& samples) {
+            for (int lane = begin; lane < count; ++lane) {
+                point<N> candidate = batch.get(lane);
 
-                ivec3 test_sample_grid_coordinates = g.convert_to_grid_coordinates(test_sample_world_coordinates);
+                // Ensure offsetting point did not push it out of bounds.
+                bool in_bounds = true;
+                for (std::size_t axis = 0; axis < N; ++axis) {
+                    in_bounds = in_bounds && candidate[axis] >= lower[axis] && candidate[axis] < upper[axis];
+                }
+                if (!in_bounds) {
+                    continue;
+                }
 
                 // Don't override cells that already have samples in them.
-                int test_sample_index = g.get(test_sample_grid_coordinates.x,
-                                              test_sample_grid_coordinates.y,
-                                              test_sample_grid_coordinates.z);
-                if (test_sample_index != NO_SAMPLE) {
+                int cell_index = g.index(g.convert_to_grid_coordinates(candidate));
+                if (!g.empty(cell_index)) {
                     continue;
                 }
 
-                bool valid_sample = true;
+                if (!g.conflicts(cell_index, candidate, r2, samples)) {
+                    return lane;
+                }
+            }
+            return -1;
+        }
+
+#if FPDS_X86_SIMD
+        // The vector kernels below evaluate one candidate per lane: the bounds test, cell lookup and every stencil
+        // distance test run on all lanes at once through masked gathers, and lanes drop out as soon as they conflict.
+        // Arithmetic matches the scalar path operation for operation (division for the cell coordinate, separate
+        // multiply and add for distances), so both accept the same candidates.
 
-                // Check grid cells directly adjacent to the test cell to ensure the validity of the selected sample.
-                for (int y = -1; y < 2; ++y) {
-                    for (int x = -1; x < 2; ++x) {
-                        for (int z = -1; z < 2; ++z) {
-                            if (x == 0 && y == 0 && z == 0) {
-                                continue;
-                            }
+        // Once a single lane remains, gathers only add overhead over scalar loads, so the remaining stencil cells
+        // (from 'first') are checked one at a time.
+        template <std::size_t N, typename Storage>
+        [[nodiscard]] int finish_lane(const grid<N, Storage>& g, const candidate_batch<N>& batch, int lane, float r2,
+                                      const std::vector<point<N>>& samples, std::size_t first) {
+            point<N> candidate = batch.get(lane);
+            int cell_index = g.index(g.convert_to_grid_coordinates(candidate));
+            return g.conflicts(cell_index, candidate, r2, samples, first) ? -1 : lane;
+        }
 
-                            int x_offset = test_sample_grid_coordinates.x + x;
-                            int y_offset = test_sample_grid_coordinates.y + y;
-                            int z_offset = test_sample_grid_coordinates.z + z;
+        template <std::size_t N, typename Storage>
+        [[nodiscard]] __attribute__((target("avx2")))
+        int first_valid_avx2(const grid<N, Storage>& g, const candidate_batch<N>& batch, int begin, int count,
+                             const point<N>& lower, const point<N>& upper, float r2, const std::vector<point<N>>& samples) {
+            const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+            __m256i valid = _mm256_cmpgt_epi32(_mm256_set1_epi32(count - begin), lanes);
 
-                            // Ensure desired offset into the grid is in range.
-                            if (x_offset < 0 || x_offset >= g.grid_width) {
-                                continue;
-                            }
-                            if (y_offset < 0 || y_offset >= g.grid_height) {
-                                continue;
-                            }
-                            if (z_offset < 0 || z_offset >= g.grid_depth) {
-                                continue;
-                            }
+            __m256 candidate[N];
+            __m256i cell_index = _mm256_setzero_si256();
 
-                            // Offset from current point.
-                            test_sample_index = g.get(x_offset, y_offset, z_offset);
+            for (std::size_t axis = 0; axis < N; ++axis) {
+                candidate[axis] = _mm256_load_ps(&batch.coordinates[axis][begin]);
 
-                            if (test_sample_index != NO_SAMPLE) {
-                                // Found existing sample in the checked grid cell.
-                                // Selected sample may still be valid if the separation between the existing and selected
-                                // samples is adequately far.
-                                const vec3& existing_sample = point_list[test_sample_index];
+                __m256 in_bounds = _mm256_and_ps(_mm256_cmp_ps(candidate[axis], _mm256_set1_ps(lower[axis]), _CMP_GE_OQ),
+                                                 _mm256_cmp_ps(candidate[axis], _mm256_set1_ps(upper[axis]), _CMP_LT_OQ));
+                valid = _mm256_and_si256(valid, _mm256_castps_si256(in_bounds));
 
-                                // Ensure separation between current and test point is at least 'r'.
-                                if (distance2(existing_sample, test_sample_world_coordinates) < r * r) {
-                                    valid_sample = false;
-                                    break;
-                                }
-                            }
-                        }
-                    }
+                // Bounds are non-negative, so for in-bounds lanes truncation is equivalent to std::floor.
+                __m256i coordinate = _mm256_cvttps_epi32(_mm256_div_ps(candidate[axis], _mm256_set1_ps(g.cell_size)));
+                coordinate = _mm256_add_epi32(coordinate, _mm256_set1_epi32(g.grid_padding));
+                cell_index = _mm256_add_epi32(cell_index, _mm256_mullo_epi32(coordinate, _mm256_set1_epi32(g.grid_strides[axis])));
+            }
+
+            if (_mm256_testz_si256(valid, valid)) {
+                return -1;
+            }
+
+            const __m256 radius2 = _mm256_set1_ps(r2);
+
+            // Don't override cells that already have samples in them.
+            if constexpr (grid<N, Storage>::inline_coordinates) {
+                const float* grid_samples = g.grid_samples.data()->data();
+                __m256i base = _mm256_mullo_epi32(cell_index, _mm256_set1_epi32(static_cast<int>(N)));
+                __m256 x = _mm256_mask_i32gather_ps(_mm256_setzero_ps(), grid_samples, base, _mm256_castsi256_ps(valid), 4);
+                valid = _mm256_and_si256(valid, _mm256_castps_si256(_mm256_cmp_ps(x, x, _CMP_UNORD_Q)));
+            }
+            else {
+                __m256i existing = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), g.grid_data.data(), cell_index, valid, 4);
+                valid = _mm256_and_si256(valid, _mm256_cmpgt_epi32(_mm256_set1_epi32(g.first_sample), existing));
+            }
+
+            for (std::size_t i = 0; i < g.neighbor_offsets.size(); ++i) {
+                int mask = _mm256_movemask_ps(_mm256_castsi256_ps(valid));
+                if (!mask) {
+                    return -1;
+                }
+                if ((mask & (mask - 1)) == 0) {
+                    // Clear the upper vector state first: the scalar code is SSE-encoded and would otherwise stall.
+                    _mm256_zeroupper();
+                    return finish_lane(g, batch, begin + __builtin_ctz(static_cast<unsigned>(mask)), r2, samples, i);
                 }
 
-                if (valid_sample) {
-                    // Record sample in grid.
-                    g.set(sample_index, test_sample_grid_coordinates.x, test_sample_grid_coordinates.y, test_sample_grid_coordinates.z);
+                int neighbor_offset = g.neighbor_offsets[i];
 
-                    point_list.emplace_back(test_sample_world_coordinates);
-                    active_list.emplace_back(sample_index);
+                __m256i neighbor = _mm256_add_epi32(cell_index, _mm256_set1_epi32(neighbor_offset));
+                __m256i occupied;
+                __m256i base;
+                const float* source;
 
-                    ++sample_index;
+                if constexpr (grid<N, Storage>::inline_coordinates) {
+                    // Empty cells hold NaN, which fails the distance comparison below.
+                    occupied = valid;
+                    base = _mm256_mullo_epi32(neighbor, _mm256_set1_epi32(static_cast<int>(N)));
+                    source = g.grid_samples.data()->data();
+                }
+                else {
+                    __m256i first_sample = _mm256_set1_epi32(g.first_sample);
+                    __m256i existing = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), g.grid_data.data(), neighbor, valid, 4);
+                    occupied = _mm256_andnot_si256(_mm256_cmpgt_epi32(first_sample, existing), valid);
+                    if (_mm256_testz_si256(occupied, occupied)) {
+                        continue;
+                    }
+                    base = _mm256_mullo_epi32(_mm256_sub_epi32(existing, first_sample), _mm256_set1_epi32(static_cast<int>(N)));
+                    source = samples.data()->data();
+                }
 
-                    found_sample = true;
-                    break;
+                __m256 distance2 = _mm256_setzero_ps();
+                for (std::size_t axis = 0; axis < N; ++axis) {
+                    __m256i index = _mm256_add_epi32(base, _mm256_set1_epi32(static_cast<int>(axis)));
+                    __m256 existing = _mm256_mask_i32gather_ps(_mm256_setzero_ps(), source, index, _mm256_castsi256_ps(occupied), 4);
+                    __m256 difference = _mm256_sub_ps(existing, candidate[axis]);
+                    distance2 = _mm256_add_ps(distance2, _mm256_mul_ps(difference, difference));
                 }
-            }
 
-            if (!found_sample) {
-                // Failed to find a valid point position after 'k' attempts.
-                // We can say, within a reasonable certainty, that no more points can fit around the chosen point.
-                active_list.erase(active_list.begin() + index);
+                __m256i conflict = _mm256_and_si256(occupied, _mm256_castps_si256(_mm256_cmp_ps(distance2, radius2, _CMP_LT_OQ)));
+                valid = _mm256_andnot_si256(conflict, valid);
             }
+
+            int mask = _mm256_movemask_ps(_mm256_castsi256_ps(valid));
+            return mask ? begin + __builtin_ctz(static_cast<unsigned>(mask)) : -1;
+        }
+
+        template <std::size_t N, typename Storage>
+        [[nodiscard]] __attribute__((target("avx512f")))
+        int first_valid_avx512(const grid<N, Storage>& g, const candidate_batch<N>& batch, int count,
+                               const point<N>& lower, const point<N>& upper, float r2, const std::vector<point<N>>& samples) {
+            __mmask16 valid = static_cast<__mmask16>((1u << count) - 1u);
+
+            __m512 candidate[N];
+            __m512i cell_index = _mm512_setzero_si512();
+
+            for (std::size_t axis = 0; axis < N; ++axis) {
+                candidate[axis] = _mm512_load_ps(&batch.coordinates[axis][0]);
+
+                valid &= _mm512_cmp_ps_mask(candidate[axis], _mm512_set1_ps(lower[axis]), _CMP_GE_OQ);
+                valid &= _mm512_cmp_ps_mask(candidate[axis], _mm512_set1_ps(upper[axis]), _CMP_LT_OQ);
+
+                // Bounds are non-negative, so for in-bounds lanes truncation is equivalent to std::floor.
+                __m512i coordinate = _mm512_maskz_cvttps_epi32(0xFFFF, _mm512_div_ps(candidate[axis], _mm512_set1_ps(g.cell_size)));
+                coordinate = _mm512_add_epi32(coordinate, _mm512_set1_epi32(g.grid_padding));
+                cell_index = _mm512_add_epi32(cell_index, _mm512_mullo_epi32(coordinate, _mm512_set1_epi32(g.grid_strides[axis])));
+            }
+
+            if (!valid) {
+                return -1;
+            }
+
+            const __m512 radius2 = _mm512_set1_ps(r2);
+
+            // Don't override cells that already have samples in them.
+            if constexpr (grid<N, Storage>::inline_coordinates) {
+                const float* grid_samples = g.grid_samples.data()->data();
+                __m512i base = _mm512_mullo_epi32(cell_index, _mm512_set1_epi32(static_cast<int>(N)));
+                __m512 x = _mm512_mask_i32gather_ps(_mm512_setzero_ps(), valid, base, grid_samples, 4);
+                valid &= _mm512_cmp_ps_mask(x, x, _CMP_UNORD_Q);
+            }
+            else {
+                __m512i existing = _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), valid, cell_index, g.grid_data.data(), 4);
+                valid &= _mm512_cmplt_epi32_mask(existing, _mm512_set1_epi32(g.first_sample));
+            }
+
+            for (std::size_t i = 0; i < g.neighbor_offsets.size(); ++i) {
+                if (!valid) {
+                    return -1;
+                }
+                if ((valid & (valid - 1)) == 0) {
+                    // Clear the upper vector state first: the scalar code is SSE-encoded and would otherwise stall.
+                    _mm256_zeroupper();
+                    return finish_lane(g, batch, __builtin_ctz(static_cast<unsigned>(valid)), r2, samples, i);
+                }
+
+                int neighbor_offset = g.neighbor_offsets[i];
+
+                __m512i neighbor = _mm512_add_epi32(cell_index, _mm512_set1_epi32(neighbor_offset));
+                __mmask16 occupied;
+                __m512i base;
+                const float* source;
+
+                if constexpr (grid<N, Storage>::inline_coordinates) {
+                    // Empty cells hold NaN, which fails the distance comparison below.
+                    occupied = valid;
+                    base = _mm512_mullo_epi32(neighbor, _mm512_set1_epi32(static_cast<int>(N)));
+                    source = g.grid_samples.data()->data();
+                }
+                else {
+                    __m512i first_sample = _mm512_set1_epi32(g.first_sample);
+                    __m512i existing = _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), valid, neighbor, g.grid_data.data(), 4);
+                    occupied = _mm512_mask_cmpge_epi32_mask(valid, existing, first_sample);
+                    if (!occupied) {
+                        continue;
+                    }
+                    base = _mm512_mullo_epi32(_mm512_sub_epi32(existing, first_sample), _mm512_set1_epi32(static_cast<int>(N)));
+                    source = samples.data()->data();
+                }
+
+                __m512 distance2 = _mm512_setzero_ps();
+                for (std::size_t axis = 0; axis < N; ++axis) {
+                    __m512i index = _mm512_add_epi32(base, _mm512_set1_epi32(static_cast<int>(axis)));
+                    __m512 existing = _mm512_mask_i32gather_ps(_mm512_setzero_ps(), occupied, index, source, 4);
+                    __m512 difference = _mm512_sub_ps(existing, candidate[axis]);
+                    distance2 = _mm512_add_ps(distance2, _mm512_mul_ps(difference, difference));
+                }
+
+                // '~' promotes the mask to int, so the result is narrowed back explicitly.
+                valid = static_cast<__mmask16>(valid & ~_mm512_mask_cmp_ps_mask(occupied, distance2, radius2, _CMP_LT_OQ));
+            }
+
+            return valid ? __builtin_ctz(static_cast<unsigned>(valid)) : -1;
+        }
+#endif
+
+        constexpr std::size_t vector_stencil_limit = 32;
+
+        // Returns the first lane in [0, count) of 'batch' holding a valid sample, or -1 if there is none. A candidate is
+        // valid if it lies within [lower, upper) (a non-negative region of the domain), in an empty cell, and no closer
+        // than 'r' to any recorded sample.
+        template <std::size_t N, typename Storage>
+        [[nodiscard]] int first_valid(const grid<N, Storage>& g, const candidate_batch<N>& batch, int count,
+                                      const point<N>& lower, const point<N>& upper, float r2, const std::vector<point<N>>& samples) {
+#if FPDS_X86_SIMD
+            // Gathers address elements through 32-bit indices scaled by N.
+            bool indexable = static_cast<long long>(g.grid_size) * static_cast<long long>(N) <= std::numeric_limits<int>::max() &&
+                             static_cast<long long>(samples.size()) * static_cast<long long>(N) <= std::numeric_limits<int>::max();
+
+            // Vector evaluation keeps scanning until every lane has conflicted, while the scalar path stops each
+            // candidate at its first conflict. That only pays off for short stencils (20 cells in 2D); with the
+            // 116+ cell stencils of 3D and above the scalar path measured as fast or faster.
+            bool profitable = g.neighbor_offsets.size() <= vector_stencil_limit;
+
+            if (indexable && profitable) {
+                switch (simd_dispatch().load(std::memory_order_relaxed)) {
+                    case simd_level::avx512:
+                        return first_valid_avx512(g, batch, count, lower, upper, r2, samples);
+                    case simd_level::avx2: {
+                        int lane = first_valid_avx2(g, batch, 0, count, lower, upper, r2, samples);
+                        if (lane < 0 && count > 8) {
+                            lane = first_valid_avx2(g, batch, 8, count, lower, upper, r2, samples);
+                        }
+                        return lane;
+                    }
+                    case simd_level::scalar:
+                        break;
+                }
+            }
+#endif
+            return first_valid_scalar(g, batch, 0, count, lower, upper, r2, samples);
+        }
+
+    }
+
+    // Instruction set used to evaluate candidates on this machine.
+    [[nodiscard]] inline simd_level active_simd_level() {
+        return detail::simd_dispatch().load(std::memory_order_relaxed);
+    }
+
+    // Restricts candidate evaluation to at most 'level' (e.g. to compare instruction sets). Levels beyond what the host
+    // CPU supports are ignored. Applies process-wide.
+    inline void limit_simd_level(simd_level level) {
+        simd_level supported = detail::detect_simd_level();
+        detail::simd_dispatch().store(level < supported ? level : supported);
+    }
+
+
+
+    // Active list policies, deciding the order in which active samples are expanded.
+    // Every policy provides a nested 'active_list<N>' template with the following interface:
+    //   active_list(const cell<N>& grid_dimensions)         - construct an empty list for a grid of the given size.
+    //   void push(int sample, const cell<N>& coordinates)   - add a newly accepted sample.
+    //   bool empty() const
+    //   int select(detail::random_stream<URBG>& random)     - choose the next sample to expand.
+    //   void retire()                                       - remove the most recently selected sample, in O(1).
+    //                                                         Only called when no sample was pushed since 'select'.
+    // and may provide:
+    //   void reserve(std::size_t samples)                   - prepare for a run expected to record about 'samples'
+    //                                                         samples (see expected_sample_count).
+    //   void reset(const cell<N>& grid_dimensions)          - empty the list for a grid of the given size, keeping its
+    //                                                         storage (see sampler, which rebuilds lists without it).
+
+    // Expands a uniformly random active sample, as described in the paper.
+    struct random_selection {
+        template <std::size_t N>
+        class active_list {
+            public:
+                explicit active_list(const cell<N>&) : selected(0) {
+                }
+
+                void reset(const cell<N>&) {
+                    samples.clear();
+                }
+
+                void push(int sample, const cell<N>&) {
+                    samples.emplace_back(sample);
+                }
+
+                [[nodiscard]] bool empty() const {
+                    return samples.empty();
+                }
+
+                template <typename URBG>
+                [[nodiscard]] int select(detail::random_stream<URBG>& random) {
+                    selected = random.index(static_cast<int>(samples.size()));
+                    return samples[selected];
+                }
+
+                void retire() {
+                    // Order is irrelevant for random selection, so the retired sample is replaced by the last one.
+                    samples[selected] = samples.back();
+                    samples.pop_back();
+                }
+
+            private:
+                std::vector<int> samples;
+                int selected;
+        };
+    };
+
+    // Expands the oldest active sample first, growing the point set as a breadth-first wavefront.
+    struct fifo_selection {
+        template <std::size_t N>
+        class active_list {
+            public:
+                explicit active_list(const cell<N>&) : head(0) {
+                }
+
+                void reset(const cell<N>&) {
+                    samples.clear();
+                    head = 0;
+                }
+
+                void push(int sample, const cell<N>&) {
+                    samples.emplace_back(sample);
+                }
+
+                [[nodiscard]] bool empty() const {
+                    return head == samples.size();
+                }
+
+                template <typename URBG>
+                [[nodiscard]] int select(detail::random_stream<URBG>&) {
+                    return samples[head];
+                }
+
+                void retire() {
+                    // The queue is a vector read from 'head', so that it keeps its storage between runs. Retired
+                    // samples are dropped once the queue empties, or once they make up more than half of the vector.
+                    ++head;
+                    if (head == samples.size()) {
+                        samples.clear();
+                        head = 0;
+                    } else if (head > samples.size() / 2) {
+                        samples.erase(samples.begin(), samples.begin() + static_cast<std::ptrdiff_t>(head));
+                        head = 0;
+                    }
+                }
+
+            private:
+                std::vector<int> samples;
+                std::size_t head;
+        };
+    };
+
+    // Expands the newest active sample first, growing the point set depth-first from the latest sample.
+    struct lifo_selection {
+        template <std::size_t N>
+        class active_list {
+            public:
+                explicit active_list(const cell<N>&) {
+                }
+
+                void reset(const cell<N>&) {
+                    samples.clear();
+                }
+
+                void push(int sample, const cell<N>&) {
+                    samples.emplace_back(sample);
+                }
+
+                [[nodiscard]] bool empty() const {
+                    return samples.empty();
+                }
+
+                template <typename URBG>
+                [[nodiscard]] int select(detail::random_stream<URBG>&) {
+                    return samples.back();
+                }
+
+                // Depth-first expansion keeps a large part of the samples active (up to two thirds in 3D), unlike the
+                // other policies, whose active front is a small fraction of the samples.
+                void reserve(std::size_t expected_samples) {
+                    samples.reserve(expected_samples);
+                }
+
+                void retire() {
+                    samples.pop_back();
+                }
+
+            private:
+                std::vector<int> samples;
+        };
+    };
+
+    // Groups active samples into coarse spatial buckets of 'bucket_cells' grid cells per axis, and always expands a
+    // random sample of the lowest non-empty bucket. Generation sweeps the domain in memory order, keeping the grid
+    // cells being touched within a small, cache-resident window.
+    struct bucketed_selection {
+        static constexpr int bucket_shift = 3;
+        static constexpr int bucket_cells = 1 << bucket_shift;
+
+        template <std::size_t N>
+        class active_list {
+            public:
+                explicit active_list(const cell<N>& grid_dimensions) : bucket_strides(), count(0), selected_bucket(0), selected(0) {
+                    reset(grid_dimensions);
+                }
+
+                // Lays the buckets out over the new grid, keeping their storage. Buckets beyond the layout of a smaller
+                // grid are kept, empty, for larger grids.
+                void reset(const cell<N>& grid_dimensions) {
+                    std::size_t bucket_count = 1;
+                    for (std::size_t i = 0; i < N; ++i) {
+                        bucket_strides[i] = static_cast<int>(bucket_count);
+                        bucket_count *= static_cast<std::size_t>((grid_dimensions[i] + bucket_cells - 1) >> bucket_shift);
+                    }
+
+                    for (std::vector<int>& bucket : buckets) {
+                        bucket.clear();
+                    }
+                    if (buckets.size() < bucket_count) {
+                        buckets.resize(bucket_count);
+                    }
+
+                    while (!pending.empty()) {
+                        pending.pop();
+                    }
+                    count = 0;
+                }
+
+                void push(int sample, const cell<N>& coordinates) {
+                    int bucket = 0;
+                    for (std::size_t i = 0; i < N; ++i) {
+                        bucket += (coordinates[i] >> bucket_shift) * bucket_strides[i];
+                    }
+
+                    if (buckets[bucket].empty()) {
+                        pending.push(bucket);
+                    }
+                    buckets[bucket].emplace_back(sample);
+                    ++count;
+                }
+
+                [[nodiscard]] bool empty() const {
+                    return count == 0;
+                }
+
+                template <typename URBG>
+                [[nodiscard]] int select(detail::random_stream<URBG>& random) {
+                    // Buckets are queued once per transition from empty to non-empty, so drained ones are skipped.
+                    while (buckets[pending.top()].empty()) {
+                        pending.pop();
+                    }
+
+                    selected_bucket = pending.top();
+                    std::vector<int>& bucket = buckets[selected_bucket];
+                    selected = random.index(static_cast<int>(bucket.size()));
+                    return bucket[selected];
+                }
+
+                void retire() {
+                    std::vector<int>& bucket = buckets[selected_bucket];
+                    bucket[selected] = bucket.back();
+                    bucket.pop_back();
+                    --count;
+
+                    if (bucket.empty()) {
+                        pending.pop();
+                    }
+                }
+
+            private:
+                cell<N> bucket_strides;
+                std::vector<std::vector<int>> buckets;
+                std::priority_queue<int, std::vector<int>, std::greater<int>> pending;
+
+                std::size_t count;
+                int selected_bucket;
+                int selected;
+        };
+    };
+
+
+
+    // Counters collected over a single sampling run, used for benchmarking.
+    struct statistics {
+        std::size_t samples = 0;    // Number of accepted samples.
+        std::size_t candidates = 0; // Number of test points generated around active samples.
+        std::size_t iterations = 0; // Number of times a sample was chosen from the active list.
+    };
+
+
+
+    // Fraction of space covered by disks of radius 'r / 2' centered on the samples of a saturated (maximal) Poisson disk
+    // set in 'n' dimensions (1 <= n <= 8): the jamming limit of random sequential addition, from Torquato, Uche and
+    // Stillinger, "Random sequential addition of hard spheres in high Euclidean dimensions" (2006). Sampling with a
+    // finite 'k' stops short of saturation: with k = 30, the bulk of a domain (measured on periodic domains) reaches
+    // about 90% of it in 2D, 80% in 3D, 69% in 4D and 59% in 5D.
+    [[nodiscard]] constexpr float saturation_density(std::size_t n) {
+        constexpr float densities[] = { 0.7476f, 0.5470f, 0.3841f, 0.2600f, 0.1707f, 0.1093f, 0.0686f, 0.0423f };
+        return densities[n - 1];
+    }
+
+    // Number of samples of a saturated Poisson disk set with minimum distance 'r' over a domain of size 'dimensions'
+    // (see saturation_density), which is an upper estimate of the output of fast_poisson_disk for any 'k': suited to
+    // reserving memory for the output, or budgeting it before launching a job. Samples pack more densely along the
+    // boundary of the domain and cover space beyond it, which is accounted for by extending the domain by 'r' along each
+    // axis (small domains may still exceed the estimate by a few percent). Both the margin and the distance from
+    // saturation grow with the dimension, so the estimate is increasingly generous: with k = 30 and r = 1, runs fill
+    // about 89% of it in 2D (200^2 domain), 77% in 3D (40^3), 58% in 4D (14^4) and 40% in 5D (8^5), and less over
+    // smaller domains. Scale it by these factors to budget typical memory use rather than an upper bound.
+    template <std::size_t N>
+    [[nodiscard]] std::size_t expected_sample_count(const point<N>& dimensions, float r) {
+        // Volume of a ball of radius 'r / 2', from the recurrence V(n) = V(n - 2) 2 pi (r / 2)^2 / n.
+        double radius = 0.5 * static_cast<double>(r);
+        std::array<double, N + 1> ball_volume;
+        ball_volume[0] = 1.0;
+        ball_volume[1] = 2.0 * radius;
+        for (std::size_t n = 2; n <= N; ++n) {
+            ball_volume[n] = ball_volume[n - 2] * 2.0 * static_cast<double>(PI) * radius * radius / static_cast<double>(n);
+        }
+
+        double volume = 1.0;
+        for (std::size_t i = 0; i < N; ++i) {
+            volume *= static_cast<double>(dimensions[i]) + static_cast<double>(r);
+        }
+
+        return static_cast<std::size_t>(std::ceil(saturation_density(N) * volume / ball_volume[N]));
+    }
+
+    // Upper estimate of the number of samples over a 2D domain (see expected_sample_count).
+    [[nodiscard]] inline std::size_t expected_sample_count(vec2 dimensions, float r) {
+        return expected_sample_count<2>({ dimensions.x, dimensions.y }, r);
+    }
+
+    // Upper estimate of the number of samples over a 3D domain (see expected_sample_count).
+    [[nodiscard]] inline std::size_t expected_sample_count(vec3 dimensions, float r) {
+        return expected_sample_count<3>({ dimensions.x, dimensions.y, dimensions.z }, r);
+    }
+
+
+
+    // Region of a domain given as a raster of pixels (voxels in 3D), each either inside or outside the region.
+    // Pixel 'p' covers [p * dimensions / resolution, (p + 1) * dimensions / resolution) along each axis.
+    template <std::size_t N>
+    class bitmap_mask {
+        public:
+            // 'dimensions' - extent of the domain, covered by the raster.
+            // 'resolution' - number of pixels along each axis.
+            // 'pixels' - whether each pixel is inside the region (nonzero), with the first axis varying fastest.
+            bitmap_mask(const point<N>& dimensions, const cell<N>& resolution, std::vector<std::uint8_t> pixels)
+                    : extent(dimensions),
+                      resolution(resolution),
+                      strides(),
+                      scale(),
+                      pixels(std::move(pixels)) {
+                int stride = 1;
+                for (std::size_t i = 0; i < N; ++i) {
+                    strides[i] = stride;
+                    stride *= resolution[i];
+                    scale[i] = static_cast<float>(resolution[i]) / dimensions[i];
+                }
+            }
+
+            [[nodiscard]] const point<N>& dimensions() const {
+                return extent;
+            }
+
+            // Number of pixels.
+            [[nodiscard]] std::size_t size() const {
+                return pixels.size();
+            }
+
+            [[nodiscard]] bool inside(std::size_t pixel) const {
+                return pixels[pixel] != 0;
+            }
+
+            // Returns whether 'position' lies within the domain, in a pixel inside the region.
+            [[nodiscard]] bool contains(const point<N>& position) const {
+                for (std::size_t i = 0; i < N; ++i) {
+                    if (!(position[i] >= 0.0f && position[i] < extent[i])) {
+                        return false;
+                    }
+                }
+                return inside(pixel(position));
+            }
+
+            // Pixel covering 'position', which must lie within the domain.
+            [[nodiscard]] std::size_t pixel(const point<N>& position) const {
+                std::size_t result = 0;
+                for (std::size_t i = 0; i < N; ++i) {
+                    int coordinate = std::min(static_cast<int>(position[i] * scale[i]), resolution[i] - 1);
+                    result += static_cast<std::size_t>(coordinate) * static_cast<std::size_t>(strides[i]);
+                }
+                return result;
+            }
+
+            // Labels the separate parts of the region (pixels inside it connected through shared faces) from 0 to
+            // 'count' - 1, in scan order of their first pixel. Pixels outside the region are labeled -1.
+            [[nodiscard]] std::vector<int> components(int& count) const {
+                std::vector<int> labels(pixels.size(), -1);
+                std::vector<std::size_t> pending;
+                count = 0;
+
+                for (std::size_t first = 0; first < pixels.size(); ++first) {
+                    if (!inside(first) || labels[first] >= 0) {
+                        continue;
+                    }
+
+                    // Flood fill from the first pixel of the part.
+                    labels[first] = count;
+                    pending.push_back(first);
+                    while (!pending.empty()) {
+                        std::size_t current = pending.back();
+                        pending.pop_back();
+
+                        for (std::size_t i = 0; i < N; ++i) {
+                            int coordinate = static_cast<int>(current / static_cast<std::size_t>(strides[i])) % resolution[i];
+                            std::size_t stride = static_cast<std::size_t>(strides[i]);
+
+                            for (std::size_t neighbor : { coordinate > 0 ? current - stride : current,
+                                                          coordinate + 1 < resolution[i] ? current + stride : current }) {
+                                if (inside(neighbor) && labels[neighbor] < 0) {
+                                    labels[neighbor] = count;
+                                    pending.push_back(neighbor);
+                                }
+                            }
+                        }
+                    }
+                    ++count;
+                }
+                return labels;
+            }
+
+            // Area covered by 'pixel'.
+            void bounds(std::size_t pixel, point<N>& lower, point<N>& upper) const {
+                for (std::size_t i = 0; i < N; ++i) {
+                    int coordinate = static_cast<int>(pixel / static_cast<std::size_t>(strides[i])) % resolution[i];
+                    lower[i] = static_cast<float>(coordinate) / scale[i];
+                    upper[i] = coordinate + 1 == resolution[i] ? extent[i] : static_cast<float>(coordinate + 1) / scale[i];
+                }
+            }
+
+        private:
+            point<N> extent;
+            cell<N> resolution;
+            cell<N> strides;
+            point<N> scale; // Pixels per unit of distance.
+            std::vector<std::uint8_t> pixels;
+    };
+
+
+
+    namespace detail {
+
+        // Records the periodic images of 'sample' (the sample shifted by the domain 'dimensions' along some axes) lying
+        // within 'r' of the domain. Images land in the padding of the grid, or in the last cells along an axis where
+        // the domain ends inside a cell, so conflict checks see samples across opposite boundaries without wrapping
+        // neighbor lookups. Images are only recorded in empty cells.
+        template <std::size_t N>
+        void insert_periodic_images(grid<N, coordinate_storage>& g, const point<N>& sample, const point<N>& dimensions, float r) {
+            for (const cell<N>& shift : adjacent_offsets<N>()) {
+                point<N> image = sample;
+                bool near = true;
+
+                for (std::size_t i = 0; i < N; ++i) {
+                    if (shift[i] < 0) {
+                        near = near && sample[i] >= dimensions[i] - r;
+                        image[i] -= dimensions[i];
+                    }
+                    else if (shift[i] > 0) {
+                        near = near && sample[i] < r;
+                        image[i] += dimensions[i];
+                    }
+                }
+
+                if (!near) {
+                    continue;
+                }
+
+                // Rounding may push an image at distance 'r' just beyond the padding, where it cannot conflict anyway.
+                cell<N> image_grid_coordinates = g.convert_to_grid_coordinates(image);
+                bool inside = true;
+                for (std::size_t i = 0; i < N; ++i) {
+                    inside = inside && image_grid_coordinates[i] >= -g.grid_padding &&
+                             image_grid_coordinates[i] < g.grid_dimensions[i] + g.grid_padding;
+                }
+
+                if (inside) {
+                    int cell_index = g.index(image_grid_coordinates);
+                    if (g.empty(cell_index)) {
+                        g.insert(cell_index, image, NO_SAMPLE);
+                    }
+                }
+            }
+        }
+
+        // Fills the cells of 'g' that no pixel inside 'mask' overlaps with samples at infinity. Such cells read as occupied,
+        // so candidates falling in them are rejected by a single lookup (in every instruction set), while they never
+        // conflict with anything. Index storage has no room for such samples, and leaves every cell open.
+        template <std::size_t N, typename Storage>
+        void exclude_masked_cells(grid<N, Storage>& g, const bitmap_mask<N>& mask) {
+            if constexpr (grid<N, Storage>::inline_coordinates) {
+                std::vector<bool> covered(static_cast<std::size_t>(g.grid_size));
+
+                // Visits every cell in the box [first, last], in row-major order.
+                auto visit = [&](const cell<N>& first, const cell<N>& last, auto&& function) {
+                    cell<N> coordinates = first;
+                    while (true) {
+                        function(g.index(coordinates));
+
+                        std::size_t axis = 0;
+                        while (axis < N && ++coordinates[axis] > last[axis]) {
+                            coordinates[axis] = first[axis];
+                            ++axis;
+                        }
+
+                        if (axis == N) {
+                            break;
+                        }
+                    }
+                };
+
+                for (std::size_t pixel = 0; pixel < mask.size(); ++pixel) {
+                    if (!mask.inside(pixel)) {
+                        continue;
+                    }
+
+                    point<N> lower;
+                    point<N> upper;
+                    mask.bounds(pixel, lower, upper);
+
+                    // Cells touching the upper bound are included too, which only leaves a few more cells open.
+                    cell<N> first = g.convert_to_grid_coordinates(lower);
+                    cell<N> last = g.convert_to_grid_coordinates(upper);
+                    for (std::size_t i = 0; i < N; ++i) {
+                        last[i] = std::min(last[i], g.grid_dimensions[i] - 1);
+                    }
+
+                    visit(first, last, [&](int cell_index) {
+                        covered[cell_index] = true;
+                    });
+                }
+
+                point<N> infinity;
+                infinity.fill(std::numeric_limits<float>::infinity());
+
+                cell<N> last;
+                for (std::size_t i = 0; i < N; ++i) {
+                    last[i] = g.grid_dimensions[i] - 1;
+                }
+
+                visit(cell<N> { }, last, [&](int cell_index) {
+                    if (!covered[cell_index]) {
+                        g.insert(cell_index, infinity, NO_SAMPLE);
+                    }
+                });
+            }
+        }
+
+        template <typename T, typename = void>
+        struct has_reserve : std::false_type { };
+
+        template <typename T>
+        struct has_reserve<T, std::void_t<decltype(std::declval<T&>().reserve(std::size_t { }))>> : std::true_type { };
+
+        template <typename T, typename Cell, typename = void>
+        struct has_reset : std::false_type { };
+
+        template <typename T, typename Cell>
+        struct has_reset<T, Cell, std::void_t<decltype(std::declval<T&>().reset(std::declval<const Cell&>()))>> : std::true_type { };
+
+        // Fast Poisson Disk Sampling algorithm (see sample), running on state owned by the caller: an empty grid 'g' laid
+        // out over 'dimensions', an empty active list for it and an empty output list 'samples', which receives every
+        // sample if 'store' (required with index storage, where the grid refers to samples through their index in it).
+        template <std::size_t N, typename Policy, typename Storage, bool Periodic, typename URBG, typename Emit>
+        FPDS_INLINE void sample_with(grid<N, Storage>& g, typename Policy::template active_list<N>& active_list, std::vector<point<N>>& samples, bool store,
+                         const point<N>& dimensions, float r, int k, URBG& generator, statistics* stats, Emit&& emit, const bitmap_mask<N>* mask) {
+            static_assert(!Periodic || std::is_same_v<Storage, coordinate_storage>, "periodic images are stored as coordinates");
+
+            random_stream<URBG> random { generator };
+            candidate_batch<N> batch;
+
+            // Presize the lists once rather than growing them through reallocations. A mask may cover a small part of
+            // the domain, and is left to grow.
+            if (!mask) {
+                std::size_t expected_samples = expected_sample_count(dimensions, r);
+                if (store) {
+                    samples.reserve(expected_samples);
+                }
+                if constexpr (has_reserve<typename Policy::template active_list<N>>::value) {
+                    active_list.reserve(expected_samples);
+                }
+            }
+
+            // Separate parts of the mask, and whether each holds a sample yet.
+            std::vector<int> component_labels;
+            std::vector<bool> sampled_components;
+            if (mask) {
+                int component_count = 0;
+                component_labels = mask->components(component_count);
+                sampled_components.assign(static_cast<std::size_t>(component_count), false);
+            }
+
+            // Records a sample in the grid, the active list and the output.
+            auto record = [&](const point<N>& sample_world_coordinates) {
+                cell<N> sample_grid_coordinates = g.convert_to_grid_coordinates(sample_world_coordinates);
+                int cell_index = g.index(sample_grid_coordinates);
+                int sample_index = static_cast<int>(samples.size());
+
+                g.insert(cell_index, sample_world_coordinates, sample_index);
+                active_list.push(grid<N, Storage>::inline_coordinates ? cell_index : sample_index, sample_grid_coordinates);
+
+                if constexpr (Periodic) {
+                    insert_periodic_images(g, sample_world_coordinates, dimensions, r);
+                }
+
+                if (store) {
+                    samples.emplace_back(sample_world_coordinates);
+                }
+                emit(sample_world_coordinates);
+
+                if (mask) {
+                    sampled_components[static_cast<std::size_t>(component_labels[mask->pixel(sample_world_coordinates)])] = true;
+                }
+            };
+
+            point<N> sample_world_coordinates { };
+            std::size_t accepted = 0;
+
+            if (mask) {
+                exclude_masked_cells(g, *mask);
+            }
+            else {
+                // Generate initial sample, randomly chosen uniformly from the given domain.
+                // Sample is in world coordinates.
+                for (std::size_t i = 0; i < N; ++i) {
+                    sample_world_coordinates[i] = random.uniform(0.0f, dimensions[i]);
+                }
+                record(sample_world_coordinates);
+                accepted = 1;
+            }
+
+            // Throws a seed into the next pixel inside the mask (in scan order) where it fits, so that regions the
+            // active samples cannot reach are sampled as well. Pixels of parts of the mask holding samples get a single
+            // attempt, to fill gaps left by the active samples; pixels of parts holding none get up to 'k', as candidates
+            // around an active sample do. Returns false once every pixel has been tried.
+            std::size_t next_pixel = 0;
+            auto seed = [&]() {
+                for (; next_pixel < mask->size(); ++next_pixel) {
+                    if (!mask->inside(next_pixel)) {
+                        continue;
+                    }
+
+                    point<N> lower;
+                    point<N> upper;
+                    mask->bounds(next_pixel, lower, upper);
+
+                    std::size_t component = static_cast<std::size_t>(component_labels[next_pixel]);
+                    for (int attempt = 0; attempt < (sampled_components[component] ? 1 : k); ++attempt) {
+                        for (std::size_t i = 0; i < N; ++i) {
+                            sample_world_coordinates[i] = random.uniform(lower[i], upper[i]);
+                        }
+
+                        // Rounding may move the seed onto a neighboring pixel.
+                        if (!mask->contains(sample_world_coordinates)) {
+                            continue;
+                        }
+
+                        int cell_index = g.index(g.convert_to_grid_coordinates(sample_world_coordinates));
+                        if (g.empty(cell_index) && !g.conflicts(cell_index, sample_world_coordinates, r * r, samples)) {
+                            record(sample_world_coordinates);
+                            ++accepted;
+                            ++next_pixel;
+                            return true;
+                        }
+                    }
+                }
+                return false;
+            };
+
+            std::size_t candidates = 0;
+            std::size_t iterations = 0;
+
+            while (!active_list.empty() || (mask && seed())) {
+                ++iterations;
+
+                // Choose sample to expand from active sample list.
+                int selected = active_list.select(random);
+                if constexpr (grid<N, Storage>::inline_coordinates) {
+                    sample_world_coordinates = g.grid_samples[selected];
+                }
+                else {
+                    sample_world_coordinates = samples[selected];
+                }
+
+                bool found_sample = false;
+
+                // Try up to 'k' times to find a valid point, generating and evaluating candidates in batches.
+                // Candidates are accepted in generation order, so the first valid candidate of a batch is kept.
+                for (int attempt = 0; attempt < k && !found_sample; attempt += batch_size) {
+                    int count = std::min(batch_size, k - attempt);
+
+                    for (int lane = 0; lane < count; ++lane) {
+                        point<N> test_sample_world_coordinates = generate_around(random, sample_world_coordinates, r);
+                        for (std::size_t axis = 0; axis < N; ++axis) {
+                            if constexpr (Periodic) {
+                                // Candidates lie within '2r' of the domain, so a single wrap brings them back. Candidates
+                                // rounding to the upper bound are rejected by the bounds check.
+                                if (test_sample_world_coordinates[axis] < 0.0f) {
+                                    test_sample_world_coordinates[axis] += dimensions[axis];
+                                }
+                                else if (test_sample_world_coordinates[axis] >= dimensions[axis]) {
+                                    test_sample_world_coordinates[axis] -= dimensions[axis];
+                                }
+                            }
+                            batch.coordinates[axis][lane] = test_sample_world_coordinates[axis];
+                        }
+                    }
+
+                    int lane = first_valid(g, batch, count, point<N> { }, dimensions, r * r, samples);
+
+                    // Cells on the border of the mask hold positions on both sides of it, so the winner is tested on
+                    // its own. Rejected winners are moved out of bounds before evaluating the rest of the batch again.
+                    while (mask && lane >= 0 && !mask->contains(batch.get(lane))) {
+                        batch.coordinates[0][lane] = -1.0f;
+                        lane = first_valid(g, batch, count, point<N> { }, dimensions, r * r, samples);
+                    }
+
+                    if (lane < 0) {
+                        candidates += count;
+                        continue;
+                    }
+
+                    candidates += lane + 1;
+
+                    record(batch.get(lane));
+                    ++accepted;
+
+                    found_sample = true;
+                }
+
+                if (!found_sample) {
+                    // Failed to find a valid point position after 'k' attempts.
+                    // We can say, within a reasonable certainty, that no more points can fit around the chosen point.
+                    active_list.retire();
+                }
+            }
+
+            if (stats) {
+                stats->samples = accepted;
+                stats->candidates = candidates;
+                stats->iterations = iterations;
+            }
+        }
+
+        // Fast Poisson Disk Sampling algorithm, passing every sample to 'emit' as soon as it is recorded.
+        // With index storage the grid refers to samples through their index in 'point_list', which receives every
+        // sample (a local list is used if 'point_list' is null; it must be empty otherwise). With coordinate storage the
+        // grid holds the samples itself and active samples are identified by their cell, so no list is needed:
+        // 'point_list' only receives samples if given, and memory use is bounded by the grid.
+        // If 'Periodic', the domain wraps around along every axis: candidates leaving it re-enter from the opposite side,
+        // and samples conflict with the periodic images of other samples (which requires coordinate storage).
+        // If 'mask' is given, samples are restricted to its region, and every separate part of the region is seeded, with
+        // up to 'k' attempts in each of its pixels until it holds a sample.
+        template <std::size_t N, typename Policy, typename Storage, bool Periodic = false, typename URBG, typename Emit>
+        void sample(const point<N>& dimensions, float r, int k, URBG& generator, statistics* stats, std::vector<point<N>>* point_list, Emit&& emit,
+                    const bitmap_mask<N>* mask = nullptr) {
+            if constexpr (Periodic) {
+                // Narrower domains would let a sample conflict with two images of the same sample across one axis.
+                for (std::size_t i = 0; i < N; ++i) {
+                    assert(r > 0.0f && dimensions[i] >= 2.0f * r && "fpds periodic domains must be at least 2r wide along every axis");
+                }
+            }
+
+            grid<N, Storage> g { dimensions, r };
+            typename Policy::template active_list<N> active_list { g.grid_dimensions };
+
+            std::vector<point<N>> local_list;
+            bool store = !grid<N, Storage>::inline_coordinates || point_list;
+
+            sample_with<N, Policy, Storage, Periodic>(g, active_list, point_list ? *point_list : local_list, store, dimensions, r, k, generator, stats,
+                                                      std::forward<Emit>(emit), mask);
+        }
+
+    }
+
+    // Fast Poisson Disk Sampling algorithm, for N-dimensional applications (2 <= N <= 8).
+    // 'r' - minimum distance to be maintained between final point samples.
+    // 'k' - limit of samples to try before sample rejection (30 is the value provided by the paper).
+    // 'generator' - source of randomness (any UniformRandomBitGenerator), owned by the caller. Runs sharing no generator
+    //               share no state and may execute concurrently.
+    // 'stats' - optional output for counters describing the run.
+    // 'Policy' - order in which active samples are expanded (see random_selection, fifo_selection, lifo_selection and
+    //            bucketed_selection).
+    // 'Storage' - contents of grid cells (see coordinate_storage and index_storage).
+    template <std::size_t N, typename Policy = random_selection, typename Storage = index_storage, typename URBG,
+              typename = detail::enable_if_generator<URBG>>
+    [[nodiscard]] std::vector<point<N>> fast_poisson_disk(const point<N>& dimensions, float r, int k, URBG& generator, statistics* stats = nullptr) {
+        std::vector<point<N>> point_list;
+        detail::sample<N, Policy, Storage>(dimensions, r, k, generator, stats, &point_list, [](const point<N>&) { });
+        return point_list;
+    }
+
+    // Overload passing every sample to 'sink' as soon as it is accepted, so consumers can start before generation ends.
+    // 'sink' - callback invoked with every sample, or output iterator every sample is written to. Returned once
+    //          generation completes, like std::copy returns its output iterator.
+    // With coordinate_storage no list of samples is kept, so memory use is bounded by the grid rather than by the output.
+    template <std::size_t N, typename Policy = random_selection, typename Storage = index_storage, typename URBG, typename Sink,
+              typename = detail::enable_if_generator<URBG>, typename = detail::enable_if_sink<Sink, point<N>>>
+    Sink fast_poisson_disk(const point<N>& dimensions, float r, int k, URBG& generator, Sink sink, statistics* stats = nullptr) {
+        detail::sample<N, Policy, Storage>(dimensions, r, k, generator, stats, nullptr, [&](const point<N>& sample) {
+            detail::emit_to(sink, sample);
+        });
+        return sink;
+    }
+
+    // Overload drawing from a generator local to the call, seeded non-deterministically.
+    template <std::size_t N, typename Policy = random_selection, typename Storage = index_storage>
+    [[nodiscard]] std::vector<point<N>> fast_poisson_disk(const point<N>& dimensions, float r, int k = 30, statistics* stats = nullptr) {
+        xoshiro128 generator { std::random_device { }() };
+        return fast_poisson_disk<N, Policy, Storage>(dimensions, r, k, generator, stats);
+    }
+
+
+
+    // Fast Poisson Disk Sampling algorithm, for 2D applications.
+    // 'r' - minimum distance to be maintained between final point samples.
+    // 'k' - limit of samples to try before sample rejection (30 is the value provided by the paper).
+    // 'generator' - source of randomness (any UniformRandomBitGenerator), owned by the caller.
+    // 'stats' - optional output for counters describing the run.
+    // 'Policy' - order in which active samples are expanded.
+    // 'Storage' - contents of grid cells.
+    template <typename Policy = random_selection, typename Storage = index_storage, typename URBG,
+              typename = detail::enable_if_generator<URBG>>
+    [[nodiscard]] std::vector<vec2> fast_poisson_disk_2d(vec2 dimensions, float r, int k, URBG& generator, statistics* stats = nullptr) {
+        std::vector<vec2> point_list;
+        point_list.reserve(expected_sample_count(dimensions, r));
+        fast_poisson_disk_2d<Policy, Storage>(dimensions, r, k, generator, std::back_inserter(point_list), stats);
+        return point_list;
+    }
+
+    // Overload passing every sample to 'sink' (a callback or output iterator) as soon as it is accepted (see
+    // fast_poisson_disk).
+    template <typename Policy = random_selection, typename Storage = index_storage, typename URBG, typename Sink,
+              typename = detail::enable_if_generator<URBG>, typename = detail::enable_if_sink<Sink, vec2>>
+    Sink fast_poisson_disk_2d(vec2 dimensions, float r, int k, URBG& generator, Sink sink, statistics* stats = nullptr) {
+        detail::sample<2, Policy, Storage>({ dimensions.x, dimensions.y }, r, k, generator, stats, nullptr, [&](const point<2>& sample) {
+            detail::emit_to(sink, vec2 { sample[0], sample[1] });
+        });
+        return sink;
+    }
+
+    // Overload drawing from a generator local to the call, seeded non-deterministically.
+    template <typename Policy = random_selection, typename Storage = index_storage>
+    [[nodiscard]] std::vector<vec2> fast_poisson_disk_2d(vec2 dimensions, float r, int k = 30, statistics* stats = nullptr) {
+        xoshiro128 generator { std::random_device { }() };
+        return fast_poisson_disk_2d<Policy, Storage>(dimensions, r, k, generator, stats);
+    }
+
+
+
+    // Fast Poisson Disk Sampling algorithm, for 3D applications.
+    // 'r' - minimum distance to be maintained between final point samples.
+    // 'k' - limit of samples to try before sample rejection (30 is the value provided by the paper).
+    // 'generator' - source of randomness (any UniformRandomBitGenerator), owned by the caller.
+    // 'stats' - optional output for counters describing the run.
+    // 'Policy' - order in which active samples are expanded.
+    // 'Storage' - contents of grid cells.
+    template <typename Policy = random_selection, typename Storage = index_storage, typename URBG,
+              typename = detail::enable_if_generator<URBG>>
+    [[nodiscard]] std::vector<vec3> fast_poisson_disk_3d(vec3 dimensions, float r, int k, URBG& generator, statistics* stats = nullptr) {
+        std::vector<vec3> point_list;
+        point_list.reserve(expected_sample_count(dimensions, r));
+        fast_poisson_disk_3d<Policy, Storage>(dimensions, r, k, generator, std::back_inserter(point_list), stats);
+        return point_list;
+    }
+
+    // Overload passing every sample to 'sink' (a callback or output iterator) as soon as it is accepted (see
+    // fast_poisson_disk).
+    template <typename Policy = random_selection, typename Storage = index_storage, typename URBG, typename Sink,
+              typename = detail::enable_if_generator<URBG>, typename = detail::enable_if_sink<Sink, vec3>>
+    Sink fast_poisson_disk_3d(vec3 dimensions, float r, int k, URBG& generator, Sink sink, statistics* stats = nullptr) {
+        detail::sample<3, Policy, Storage>({ dimensions.x, dimensions.y, dimensions.z }, r, k, generator, stats, nullptr, [&](const point<3>& sample) {
+            detail::emit_to(sink, vec3 { sample[0], sample[1], sample[2] });
+        });
+        return sink;
+    }
+
+    // Overload drawing from a generator local to the call, seeded non-deterministically.
+    template <typename Policy = random_selection, typename Storage = index_storage>
+    [[nodiscard]] std::vector<vec3> fast_poisson_disk_3d(vec3 dimensions, float r, int k = 30, statistics* stats = nullptr) {
+        xoshiro128 generator { std::random_device { }() };
+        return fast_poisson_disk_3d<Policy, Storage>(dimensions, r, k, generator, stats);
+    }
+
+
+
+    // Fast Poisson Disk Sampling algorithm (see fast_poisson_disk), keeping its grid, active list and output list between
+    // runs, for applications sampling many domains in a row (e.g. thousands of small domains per second). Buffers grow to
+    // fit the largest domain sampled and are then reused, so later runs allocate no memory, as long as the policy's active
+    // list keeps its storage (all the policies of this library do). When the grid dimensions change, the active list is
+    // reset for the new grid, keeping its storage, or rebuilt if its policy provides no 'reset' (see the active list
+    // policies). With index storage, the grid is emptied in O(1) between runs by raising the index its samples are stored
+    // from (see grid::reset); coordinate storage refills it. Not thread-safe: use one sampler per thread.
+    template <std::size_t N, typename Policy = random_selection, typename Storage = index_storage>
+    class sampler {
+        static_assert(N >= 2 && N <= 8, "fpds::sampler supports between 2 and 8 dimensions");
+
+        public:
+            // Samples the domain, with the same parameters and output as fast_poisson_disk. The returned samples are valid
+            // until the next run.
+            template <typename URBG, typename = detail::enable_if_generator<URBG>>
+            const std::vector<point<N>>& run(const point<N>& dimensions, float r, int k, URBG& generator, statistics* stats = nullptr) {
+                if (g) {
+                    cell<N> previous_dimensions = g->grid_dimensions;
+                    g->reset(dimensions, r, samples.size());
+                    if (g->grid_dimensions != previous_dimensions) {
+                        if constexpr (detail::has_reset<typename Policy::template active_list<N>, cell<N>>::value) {
+                            active_list->reset(g->grid_dimensions);
+                        }
+                        else {
+                            active_list.emplace(g->grid_dimensions);
+                        }
+                    }
+                }
+                else {
+                    g.emplace(dimensions, r);
+                    active_list.emplace(g->grid_dimensions);
+                }
+
+                samples.clear();
+                detail::sample_with<N, Policy, Storage, false>(*g, *active_list, samples, true, dimensions, r, k, generator, stats,
+                                                               [](const point<N>&) { }, nullptr);
+                return samples;
+            }
+
+            // Samples of the last run.
+            [[nodiscard]] const std::vector<point<N>>& points() const {
+                return samples;
+            }
+
+        private:
+            std::optional<grid<N, Storage>> g;
+            std::optional<typename Policy::template active_list<N>> active_list; // Empty between runs.
+            std::vector<point<N>> samples;
+    };
+
+
+
+    // Periodic Fast Poisson Disk Sampling algorithm, for N-dimensional applications (2 <= N <= 8).
+    // The domain wraps around along every axis, so the minimum distance 'r' is also maintained across opposite
+    // boundaries: the samples tile space seamlessly when repeated with period 'dimensions' (e.g. for tileable textures).
+    // Each dimension must be at least '2r' (asserted).
+    // 'r' - minimum distance to be maintained between final point samples.
+    // 'k' - limit of samples to try before sample rejection (30 is the value provided by the paper).
+    // 'generator' - source of randomness (any UniformRandomBitGenerator), owned by the caller.
+    // 'stats' - optional output for counters describing the run.
+    // 'Policy' - order in which active samples are expanded.
+    // The grid always stores coordinates inline (see coordinate_storage), since periodic images are shifted copies of
+    // the samples.
+    template <std::size_t N, typename Policy = random_selection, typename URBG, typename = detail::enable_if_generator<URBG>>
+    [[nodiscard]] std::vector<point<N>> fast_poisson_disk_periodic(const point<N>& dimensions, float r, int k, URBG& generator,
+                                                                   statistics* stats = nullptr) {
+        std::vector<point<N>> point_list;
+        detail::sample<N, Policy, coordinate_storage, true>(dimensions, r, k, generator, stats, &point_list, [](const point<N>&) { });
+        return point_list;
+    }
+
+    // Overload passing every sample to 'sink' (a callback or output iterator) as soon as it is accepted (see
+    // fast_poisson_disk).
+    template <std::size_t N, typename Policy = random_selection, typename URBG, typename Sink,
+              typename = detail::enable_if_generator<URBG>, typename = detail::enable_if_sink<Sink, point<N>>>
+    Sink fast_poisson_disk_periodic(const point<N>& dimensions, float r, int k, URBG& generator, Sink sink, statistics* stats = nullptr) {
+        detail::sample<N, Policy, coordinate_storage, true>(dimensions, r, k, generator, stats, nullptr, [&](const point<N>& sample) {
+            detail::emit_to(sink, sample);
+        });
+        return sink;
+    }
+
+    // Overload drawing from a generator local to the call, seeded non-deterministically.
+    template <std::size_t N, typename Policy = random_selection>
+    [[nodiscard]] std::vector<point<N>> fast_poisson_disk_periodic(const point<N>& dimensions, float r, int k = 30, statistics* stats = nullptr) {
+        xoshiro128 generator { std::random_device { }() };
+        return fast_poisson_disk_periodic<N, Policy>(dimensions, r, k, generator, stats);
+    }
+
+    // Periodic Fast Poisson Disk Sampling algorithm, for 2D applications (see fast_poisson_disk_periodic).
+    template <typename Policy = random_selection, typename URBG, typename = detail::enable_if_generator<URBG>>
+    [[nodiscard]] std::vector<vec2> fast_poisson_disk_periodic_2d(vec2 dimensions, float r, int k, URBG& generator, statistics* stats = nullptr) {
+        std::vector<vec2> point_list;
+        point_list.reserve(expected_sample_count(dimensions, r));
+        fast_poisson_disk_periodic<2, Policy>({ dimensions.x, dimensions.y }, r, k, generator, [&](const point<2>& sample) {
+            point_list.emplace_back(sample[0], sample[1]);
+        }, stats);
+        return point_list;
+    }
+
+    // Overload drawing from a generator local to the call, seeded non-deterministically.
+    template <typename Policy = random_selection>
+    [[nodiscard]] std::vector<vec2> fast_poisson_disk_periodic_2d(vec2 dimensions, float r, int k = 30, statistics* stats = nullptr) {
+        xoshiro128 generator { std::random_device { }() };
+        return fast_poisson_disk_periodic_2d<Policy>(dimensions, r, k, generator, stats);
+    }
+
+    // Periodic Fast Poisson Disk Sampling algorithm, for 3D applications (see fast_poisson_disk_periodic).
+    template <typename Policy = random_selection, typename URBG, typename = detail::enable_if_generator<URBG>>
+    [[nodiscard]] std::vector<vec3> fast_poisson_disk_periodic_3d(vec3 dimensions, float r, int k, URBG& generator, statistics* stats = nullptr) {
+        std::vector<vec3> point_list;
+        point_list.reserve(expected_sample_count(dimensions, r));
+        fast_poisson_disk_periodic<3, Policy>({ dimensions.x, dimensions.y, dimensions.z }, r, k, generator, [&](const point<3>& sample) {
+            point_list.emplace_back(sample[0], sample[1], sample[2]);
+        }, stats);
+        return point_list;
+    }
+
+    // Overload drawing from a generator local to the call, seeded non-deterministically.
+    template <typename Policy = random_selection>
+    [[nodiscard]] std::vector<vec3> fast_poisson_disk_periodic_3d(vec3 dimensions, float r, int k = 30, statistics* stats = nullptr) {
+        xoshiro128 generator { std::random_device { }() };
+        return fast_poisson_disk_periodic_3d<Policy>(dimensions, r, k, generator, stats);
+    }
+
+
+
+    // Masked Fast Poisson Disk Sampling algorithm, for N-dimensional applications (2 <= N <= 8).
+    // Samples only the region of 'mask', over the domain it covers. Grid cells outside the region are marked before
+    // sampling, so candidates falling there are rejected by the same lookup as occupied cells, and only candidates
+    // accepted on the border of the region are tested against individual pixels. Every separate part of the region is
+    // seeded from its pixels (with up to 'k' attempts in each pixel until the part holds a sample), so sparse and
+    // disconnected masks are sampled without generating over the whole domain.
+    // 'mask' - region to sample.
+    // 'r' - minimum distance to be maintained between final point samples.
+    // 'k' - limit of samples to try before sample rejection (30 is the value provided by the paper).
+    // 'generator' - source of randomness (any UniformRandomBitGenerator), owned by the caller.
+    // 'stats' - optional output for counters describing the run.
+    // 'Policy' - order in which active samples are expanded.
+    // The grid always stores coordinates inline (see coordinate_storage), which is where excluded cells are marked.
+    template <std::size_t N, typename Policy = random_selection, typename URBG, typename = detail::enable_if_generator<URBG>>
+    [[nodiscard]] std::vector<point<N>> fast_poisson_disk_masked(const bitmap_mask<N>& mask, float r, int k, URBG& generator,
+                                                                 statistics* stats = nullptr) {
+        std::vector<point<N>> point_list;
+        detail::sample<N, Policy, coordinate_storage>(mask.dimensions(), r, k, generator, stats, &point_list, [](const point<N>&) { }, &mask);
+        return point_list;
+    }
+
+    // Overload passing every sample to 'sink' (a callback or output iterator) as soon as it is accepted (see
+    // fast_poisson_disk).
+    template <std::size_t N, typename Policy = random_selection, typename URBG, typename Sink,
+              typename = detail::enable_if_generator<URBG>, typename = detail::enable_if_sink<Sink, point<N>>>
+    Sink fast_poisson_disk_masked(const bitmap_mask<N>& mask, float r, int k, URBG& generator, Sink sink, statistics* stats = nullptr) {
+        detail::sample<N, Policy, coordinate_storage>(mask.dimensions(), r, k, generator, stats, nullptr, [&](const point<N>& sample) {
+            detail::emit_to(sink, sample);
+        }, &mask);
+        return sink;
+    }
+
+    // Overload drawing from a generator local to the call, seeded non-deterministically.
+    template <std::size_t N, typename Policy = random_selection>
+    [[nodiscard]] std::vector<point<N>> fast_poisson_disk_masked(const bitmap_mask<N>& mask, float r, int k = 30, statistics* stats = nullptr) {
+        xoshiro128 generator { std::random_device { }() };
+        return fast_poisson_disk_masked<N, Policy>(mask, r, k, generator, stats);
+    }
+
+    // Masked Fast Poisson Disk Sampling algorithm, for 2D applications (see fast_poisson_disk_masked).
+    template <typename Policy = random_selection, typename URBG, typename = detail::enable_if_generator<URBG>>
+    [[nodiscard]] std::vector<vec2> fast_poisson_disk_masked_2d(const bitmap_mask<2>& mask, float r, int k, URBG& generator, statistics* stats = nullptr) {
+        std::vector<vec2> point_list;
+        fast_poisson_disk_masked<2, Policy>(mask, r, k, generator, [&](const point<2>& sample) {
+            point_list.emplace_back(sample[0], sample[1]);
+        }, stats);
+        return point_list;
+    }
+
+    // Overload drawing from a generator local to the call, seeded non-deterministically.
+    template <typename Policy = random_selection>
+    [[nodiscard]] std::vector<vec2> fast_poisson_disk_masked_2d(const bitmap_mask<2>& mask, float r, int k = 30, statistics* stats = nullptr) {
+        xoshiro128 generator { std::random_device { }() };
+        return fast_poisson_disk_masked_2d<Policy>(mask, r, k, generator, stats);
+    }
+
+    // Masked Fast Poisson Disk Sampling algorithm, for 3D applications (see fast_poisson_disk_masked).
+    template <typename Policy = random_selection, typename URBG, typename = detail::enable_if_generator<URBG>>
+    [[nodiscard]] std::vector<vec3> fast_poisson_disk_masked_3d(const bitmap_mask<3>& mask, float r, int k, URBG& generator, statistics* stats = nullptr) {
+        std::vector<vec3> point_list;
+        fast_poisson_disk_masked<3, Policy>(mask, r, k, generator, [&](const point<3>& sample) {
+            point_list.emplace_back(sample[0], sample[1], sample[2]);
+        }, stats);
+        return point_list;
+    }
+
+    // Overload drawing from a generator local to the call, seeded non-deterministically.
+    template <typename Policy = random_selection>
+    [[nodiscard]] std::vector<vec3> fast_poisson_disk_masked_3d(const bitmap_mask<3>& mask, float r, int k = 30, statistics* stats = nullptr) {
+        xoshiro128 generator { std::random_device { }() };
+        return fast_poisson_disk_masked_3d<Policy>(mask, r, k, generator, stats);
+    }
+
+
+
+    // Sample on the surface of a triangle mesh.
+    struct surface_sample {
+        vec3 position;
+        int triangle; // Index of the triangle holding the sample, i.e. of its first vertex index divided by 3.
+    };
+
+    namespace detail {
+
+        [[nodiscard]] inline point<3> subtract(const point<3>& a, const point<3>& b) {
+            return { a[0] - b[0], a[1] - b[1], a[2] - b[2] };
+        }
+
+        // Returns 'a' scaled to unit length, or null if its length is zero.
+        [[nodiscard]] inline point<3> normalize(const point<3>& a) {
+            float length2 = a[0] * a[0] + a[1] * a[1] + a[2] * a[2];
+            if (!(length2 > 0.0f)) {
+                return { };
+            }
+
+            float scale = 1.0f / std::sqrt(length2);
+            return { a[0] * scale, a[1] * scale, a[2] * scale };
+        }
+
+        // Returns 'a + b * scale'.
+        [[nodiscard]] inline point<3> multiply_add(const point<3>& a, const point<3>& b, float scale) {
+            return { a[0] + b[0] * scale, a[1] + b[1] * scale, a[2] + b[2] * scale };
+        }
+
+        [[nodiscard]] inline float dot(const point<3>& a, const point<3>& b) {
+            return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+        }
+
+        [[nodiscard]] inline point<3> cross(const point<3>& a, const point<3>& b) {
+            return { a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0] };
+        }
+
+        // Spreads the low 10 bits of 'value' to every third bit, for Morton codes.
+        [[nodiscard]] inline std::uint32_t spread_bits(std::uint32_t value) {
+            value &= 0x3FF;
+            value = (value | value << 16) & 0x030000FF;
+            value = (value | value << 8) & 0x0300F00F;
+            value = (value | value << 4) & 0x030C30C3;
+            value = (value | value << 2) & 0x09249249;
+            return value;
+        }
+
+        // Triangle mesh with edge adjacency, for walking across the surface. Edge 'e' of a triangle runs from its corner
+        // 'e' to its corner 'e + 1'. Every triangle is stored as a single record holding everything a step of a walk
+        // reads, and records are sorted in Morton order of the triangle centroids, so walks touch few, nearby cache
+        // lines instead of chasing vertex indices across the buffers; 'original' maps records back to input triangles.
+        class surface_mesh {
+            public:
+                surface_mesh(const std::vector<vec3>& vertices, const std::vector<std::uint32_t>& indices)
+                        : triangles(indices.size() / 3),
+                          original(indices.size() / 3) {
+                    point<3> lower;
+                    point<3> upper;
+                    lower.fill(std::numeric_limits<float>::max());
+                    upper.fill(std::numeric_limits<float>::lowest());
+                    for (const vec3& vertex : vertices) {
+                        point<3> position { vertex.x, vertex.y, vertex.z };
+                        for (std::size_t i = 0; i < 3; ++i) {
+                            lower[i] = std::min(lower[i], position[i]);
+                            upper[i] = std::max(upper[i], position[i]);
+                        }
+                    }
+
+                    std::vector<std::pair<std::uint32_t, std::uint32_t>> order(triangles.size());
+                    for (std::size_t triangle = 0; triangle < triangles.size(); ++triangle) {
+                        std::uint32_t code = 0;
+                        for (std::size_t i = 0; i < 3; ++i) {
+                            float centroid = (vertices[indices[3 * triangle]].*axes[i] + vertices[indices[3 * triangle + 1]].*axes[i] +
+                                              vertices[indices[3 * triangle + 2]].*axes[i]) / 3.0f;
+                            float extent = std::max(upper[i] - lower[i], std::numeric_limits<float>::min());
+                            code |= spread_bits(static_cast<std::uint32_t>((centroid - lower[i]) / extent * 1023.0f)) << i;
+                        }
+                        order[triangle] = { code, static_cast<std::uint32_t>(triangle) };
+                    }
+                    std::sort(order.begin(), order.end());
+
+                    std::vector<std::uint32_t> sorted_indices(indices.size());
+                    for (std::size_t triangle = 0; triangle < triangles.size(); ++triangle) {
+                        std::uint32_t input = order[triangle].second;
+                        original[triangle] = static_cast<int>(input);
+
+                        record& t = triangles[triangle];
+                        for (std::size_t corner = 0; corner < 3; ++corner) {
+                            sorted_indices[3 * triangle + corner] = indices[3 * input + corner];
+                            const vec3& vertex = vertices[indices[3 * input + corner]];
+                            t.corners[corner] = { vertex.x, vertex.y, vertex.z };
+                            t.neighbors[corner] = -1;
+                        }
+
+                        // Degenerate triangles keep null normals, which stop any walk entering them.
+                        t.normal = normalize(cross(subtract(t.corners[1], t.corners[0]), subtract(t.corners[2], t.corners[0])));
+                        for (std::size_t edge = 0; edge < 3; ++edge) {
+                            t.inward[edge] = normalize(cross(t.normal, subtract(t.corners[(edge + 1) % 3], t.corners[edge])));
+                        }
+                    }
+
+                    // Edges shared by two triangles are found by sorting all edges by their (unordered) vertices.
+                    // Non-manifold edges pair up their triangles two by two.
+                    std::vector<std::pair<std::uint64_t, int>> edges;
+                    edges.reserve(sorted_indices.size());
+                    for (std::size_t half_edge = 0; half_edge < sorted_indices.size(); ++half_edge) {
+                        std::uint64_t from = sorted_indices[half_edge];
+                        std::uint64_t to = sorted_indices[half_edge - half_edge % 3 + (half_edge + 1) % 3];
+                        edges.emplace_back(std::min(from, to) << 32 | std::max(from, to), static_cast<int>(half_edge));
+                    }
+                    std::sort(edges.begin(), edges.end());
+
+                    for (std::size_t i = 0; i + 1 < edges.size(); ++i) {
+                        if (edges[i].first == edges[i + 1].first) {
+                            int a = edges[i].second;
+                            int b = edges[i + 1].second;
+                            triangles[a / 3].neighbors[a % 3] = b;
+                            triangles[b / 3].neighbors[b % 3] = a;
+                            ++i;
+                        }
+                    }
+                }
+
+                [[nodiscard]] int triangle_count() const {
+                    return static_cast<int>(triangles.size());
+                }
+
+                [[nodiscard]] const point<3>& vertex(int triangle, int corner) const {
+                    return triangles[triangle].corners[corner];
+                }
+
+                // Unit normal of 'triangle', or null if it is degenerate.
+                [[nodiscard]] const point<3>& normal(int triangle) const {
+                    return triangles[triangle].normal;
+                }
+
+                // Walks from 'position' on 'triangle' along 'direction' (a unit vector in the plane of the triangle) for
+                // 'length', unfolding the path across the edges it crosses, so that it keeps its length along the
+                // surface. Returns the triangle reached and updates 'position', or returns -1 if the path leaves the mesh
+                // through a boundary edge, runs into a degenerate triangle or crosses too many triangles.
+                [[nodiscard]] int walk(int triangle, point<3>& position, point<3> direction, float length) const {
+                    int entry_edge = -1;
+
+                    for (int step = 0; step < max_walk_steps; ++step) {
+                        const record& t = triangles[triangle];
+
+                        // Find the first edge the path reaches, from the distance to each edge along its inward normal.
+                        float exit_distance = std::numeric_limits<float>::infinity();
+                        int exit_edge = -1;
+
+                        for (int edge = 0; edge < 3; ++edge) {
+                            if (edge == entry_edge) {
+                                continue;
+                            }
+
+                            float approach = -dot(direction, t.inward[edge]);
+                            if (approach > 0.0f) {
+                                float distance = std::max(dot(subtract(position, t.corners[edge]), t.inward[edge]), 0.0f) / approach;
+                                if (distance < exit_distance) {
+                                    exit_distance = distance;
+                                    exit_edge = edge;
+                                }
+                            }
+                        }
+
+                        if (exit_edge < 0) {
+                            return -1;
+                        }
+
+                        if (length <= exit_distance) {
+                            position = multiply_add(position, direction, length);
+                            return triangle;
+                        }
+
+                        position = multiply_add(position, direction, exit_distance);
+                        length -= exit_distance;
+
+                        int shared_half_edge = t.neighbors[exit_edge];
+                        if (shared_half_edge < 0) {
+                            return -1;
+                        }
+
+                        triangle = shared_half_edge / 3;
+                        entry_edge = shared_half_edge % 3;
+
+                        // Rotate the direction about the shared edge into the plane of the neighbor, where the inward
+                        // normal of the shared edge takes the place of the exit edge's outward normal.
+                        point<3> edge_direction = cross(t.inward[exit_edge], t.normal);
+                        float along = dot(direction, edge_direction);
+                        float across = std::sqrt(std::max(1.0f - along * along, 0.0f));
+                        direction = multiply_add(multiply_add({ }, edge_direction, along), triangles[triangle].inward[entry_edge], across);
+                    }
+
+                    return -1;
+                }
+
+            private:
+                // Bounds the cost of walks across triangles much smaller than 'r'.
+                static constexpr int max_walk_steps = 1024;
+
+                static constexpr float vec3::* axes[3] = { &vec3::x, &vec3::y, &vec3::z };
+
+                struct record {
+                    std::array<point<3>, 3> corners;
+                    std::array<point<3>, 3> inward; // Unit normal of every edge, in the plane of the triangle, pointing inside.
+                    point<3> normal;
+                    std::array<int, 3> neighbors;   // Edge across every edge (as 3 * triangle + edge), -1 on boundaries.
+                };
+
+                std::vector<record> triangles;
+
+            public:
+                std::vector<int> original; // Index of every triangle in the input.
+        };
+
+        // Samples hashed by cubic cells of side 'r', so that conflicts are found in the 27 cells around a position.
+        // Only occupied cells are stored, so memory follows the number of samples rather than the volume enclosing
+        // them, which for a surface would be mostly empty.
+        class spatial_hash {
+            public:
+                spatial_hash(const point<3>& origin, float r) : origin(origin), cell_size(r), count(0), shift(64 - 10) {
+                    slots.assign(std::size_t { 1 } << 10, { empty_key, NO_SAMPLE });
+                }
+
+                // Cell coordinates, relative to the origin. Supports up to 2^20 cells along each axis.
+                [[nodiscard]] cell<3> convert_to_cell(const point<3>& position) const {
+                    cell<3> result;
+                    for (std::size_t i = 0; i < 3; ++i) {
+                        result[i] = static_cast<int>(std::floor((position[i] - origin[i]) / cell_size));
+                    }
+                    return result;
+                }
+
+                // Returns whether any sample in 'samples' recorded in the hash lies closer than 'r' to 'position'.
+                [[nodiscard]] bool conflicts(const point<3>& position, float r2, const std::vector<point<3>>& samples) const {
+                    cell<3> center = convert_to_cell(position);
+
+                    auto conflicts_in = [&](const cell<3>& coordinates) {
+                        for (int sample = slots[find(key(coordinates))].head; sample != NO_SAMPLE; sample = next[sample]) {
+                            if (distance2(samples[sample], position) < r2) {
+                                return true;
+                            }
+                        }
+                        return false;
+                    };
+
+                    if (conflicts_in(center)) {
+                        return true;
+                    }
+
+                    for (const cell<3>& offset : adjacent_offsets<3>()) {
+                        if (conflicts_in({ center[0] + offset[0], center[1] + offset[1], center[2] + offset[2] })) {
+                            return true;
+                        }
+                    }
+                    return false;
+                }
+
+                // Records sample 'sample', at 'position'. Samples must be inserted in increasing order.
+                void insert(const point<3>& position, int sample) {
+                    if (2 * (count + 1) > slots.size()) {
+                        grow();
+                    }
+
+                    std::uint64_t sample_key = key(convert_to_cell(position));
+                    slot& cell_slot = slots[find(sample_key)];
+                    if (cell_slot.key == empty_key) {
+                        cell_slot.key = sample_key;
+                        ++count;
+                    }
+
+                    next.emplace_back(cell_slot.head);
+                    cell_slot.head = sample;
+                }
+
+            private:
+                // Occupied cell, keeping its key next to its samples so that a lookup touches a single cache line.
+                struct slot {
+                    std::uint64_t key; // Packed cell coordinates, or 'empty_key'.
+                    int head;          // Last sample recorded in the cell.
+                };
+
+                static constexpr std::uint64_t empty_key = ~std::uint64_t { 0 };
+
+                [[nodiscard]] static std::uint64_t key(const cell<3>& coordinates) {
+                    std::uint64_t result = 0;
+                    for (std::size_t i = 0; i < 3; ++i) {
+                        result = result << 21 | (static_cast<std::uint64_t>(coordinates[i] + (1 << 20)) & 0x1FFFFF);
+                    }
+                    return result;
+                }
+
+                // Slot holding 'cell_key', or the empty slot where it would be inserted (with linear probing).
+                [[nodiscard]] std::size_t find(std::uint64_t cell_key) const {
+                    std::size_t mask = slots.size() - 1;
+                    std::size_t index = static_cast<std::size_t>((cell_key * UINT64_C(0x9E3779B97F4A7C15)) >> shift);
+                    while (slots[index].key != cell_key && slots[index].key != empty_key) {
+                        index = (index + 1) & mask;
+                    }
+                    return index;
+                }
+
+                void grow() {
+                    std::vector<slot> old_slots = std::move(slots);
+
+                    slots.assign(old_slots.size() * 2, { empty_key, NO_SAMPLE });
+                    --shift;
+
+                    for (const slot& old_slot : old_slots) {
+                        if (old_slot.key != empty_key) {
+                            slots[find(old_slot.key)] = old_slot;
+                        }
+                    }
+                }
+
+                point<3> origin;
+                float cell_size;
+
+                std::vector<slot> slots;
+                std::vector<int> next; // Previous sample recorded in the same cell, for every sample.
+                std::size_t count;     // Number of occupied cells.
+                int shift;             // 64 - log2(slots.size()).
+        };
+
+    }
+
+    // Fast Poisson Disk Sampling on the surface of a triangle mesh.
+    // Active samples are expanded by walking a random distance in [r, 2r] in a random direction along the surface,
+    // unfolding the path across triangle edges, so candidates are spread by (approximate) geodesic distance. Samples are
+    // kept at least 'r' apart in Euclidean distance, found through a hash of occupied grid cells. Whenever the active
+    // list runs dry, a seed is thrown into the next triangle (in index order) with room for it, so every connected part
+    // of the mesh is sampled. Degenerate triangles are skipped; paths crossing boundary edges are rejected.
+    // 'vertices' - vertex positions.
+    // 'indices' - three vertex indices per triangle. Consistent winding is not required.
+    // 'r' - minimum distance to be maintained between final point samples.
+    // 'k' - limit of samples to try before sample rejection (30 is the value provided by the paper).
+    // 'generator' - source of randomness (any UniformRandomBitGenerator), owned by the caller.
+    // 'stats' - optional output for counters describing the run.
+    // 'Policy' - order in which active samples are expanded.
+    template <typename Policy = random_selection, typename URBG, typename = detail::enable_if_generator<URBG>>
+    [[nodiscard]] std::vector<surface_sample> fast_poisson_disk_surface(const std::vector<vec3>& vertices, const std::vector<std::uint32_t>& indices,
+                                                                        float r, int k, URBG& generator, statistics* stats = nullptr) {
+        detail::surface_mesh mesh { vertices, indices };
+        detail::random_stream<URBG> random { generator };
+        float r2 = r * r;
+
+        point<3> lower;
+        point<3> upper;
+        lower.fill(std::numeric_limits<float>::max());
+        upper.fill(std::numeric_limits<float>::lowest());
+        for (const vec3& vertex : vertices) {
+            point<3> position { vertex.x, vertex.y, vertex.z };
+            for (std::size_t i = 0; i < 3; ++i) {
+                lower[i] = std::min(lower[i], position[i]);
+                upper[i] = std::max(upper[i], position[i]);
+            }
+        }
+
+        detail::spatial_hash hash { lower, r };
+
+        cell<3> hash_dimensions = hash.convert_to_cell(upper);
+        for (int& dimension : hash_dimensions) {
+            dimension = std::max(dimension + 1, 1);
+        }
+
+        typename Policy::template active_list<3> active_list { hash_dimensions };
+
+        std::vector<point<3>> positions;
+        std::vector<int> triangles;
+
+        // Records a sample in the hash, the active list and the output.
+        auto record = [&](const point<3>& position, int triangle) {
+            int sample = static_cast<int>(positions.size());
+            hash.insert(position, sample);
+
+            // Walks may end a rounding error outside the bounding box.
+            cell<3> coordinates = hash.convert_to_cell(position);
+            for (std::size_t i = 0; i < 3; ++i) {
+                coordinates[i] = std::clamp(coordinates[i], 0, hash_dimensions[i] - 1);
+            }
+            active_list.push(sample, coordinates);
+            positions.emplace_back(position);
+            triangles.emplace_back(triangle);
+        };
+
+        // Throws a seed, uniformly distributed, into the next triangle where it fits.
+        int next_triangle = 0;
+        auto seed = [&]() {
+            for (; next_triangle < mesh.triangle_count(); ++next_triangle) {
+                const point<3>& triangle_normal = mesh.normal(next_triangle);
+                if (!(detail::dot(triangle_normal, triangle_normal) > 0.0f)) {
+                    continue;
+                }
+
+                const point<3>& a = mesh.vertex(next_triangle, 0);
+                float s = std::sqrt(random.uniform(0.0f, 1.0f));
+                float t = random.uniform(0.0f, 1.0f);
+
+                point<3> position = detail::multiply_add(a, detail::subtract(mesh.vertex(next_triangle, 1), a), s * (1.0f - t));
+                position = detail::multiply_add(position, detail::subtract(mesh.vertex(next_triangle, 2), a), s * t);
+
+                if (!hash.conflicts(position, r2, positions)) {
+                    record(position, next_triangle);
+                    ++next_triangle;
+                    return true;
+                }
+            }
+            return false;
+        };
+
+        std::size_t candidates = 0;
+        std::size_t iterations = 0;
+
+        while (!active_list.empty() || seed()) {
+            ++iterations;
+
+            // Choose sample to expand from active sample list.
+            int selected = active_list.select(random);
+            int triangle = triangles[selected];
+
+            // Orthonormal basis of the plane of the sample's triangle.
+            point<3> tangent = detail::normalize(detail::subtract(mesh.vertex(triangle, 1), mesh.vertex(triangle, 0)));
+            point<3> bitangent = detail::cross(mesh.normal(triangle), tangent);
+
+            bool found_sample = false;
+
+            // Try up to 'k' times to find a valid point.
+            for (int attempt = 0; attempt < k && !found_sample; ++attempt) {
+                ++candidates;
+
+                // Direction uniformly distributed on the unit circle, by rejection from the unit disk.
+                float u;
+                float v;
+                float s;
+                do {
+                    u = random.uniform(-1.0f, 1.0f);
+                    v = random.uniform(-1.0f, 1.0f);
+                    s = u * u + v * v;
+                } while (s > 1.0f || s == 0.0f);
+
+                float scale = 1.0f / std::sqrt(s);
+                point<3> direction = detail::multiply_add(detail::multiply_add({ }, tangent, u * scale), bitangent, v * scale);
+
+                point<3> position = positions[selected];
+                int reached = mesh.walk(triangle, position, direction, random.uniform(r, 2.0f * r));
+
+                if (reached >= 0 && !hash.conflicts(position, r2, positions)) {
+                    record(position, reached);
+                    found_sample = true;
+                }
+            }
+
+            if (!found_sample) {
+                // Failed to find a valid point position after 'k' attempts.
+                active_list.retire();
+            }
+        }
+
+        if (stats) {
+            stats->samples = positions.size();
+            stats->candidates = candidates;
+            stats->iterations = iterations;
+        }
+
+        std::vector<surface_sample> point_list;
+        point_list.reserve(positions.size());
+        for (std::size_t sample = 0; sample < positions.size(); ++sample) {
+            const point<3>& position = positions[sample];
+            point_list.push_back({ vec3 { position[0], position[1], position[2] }, mesh.original[triangles[sample]] });
+        }
+
+        return point_list;
+    }
+
+    // Overload drawing from a generator local to the call, seeded non-deterministically.
+    template <typename Policy = random_selection>
+    [[nodiscard]] std::vector<surface_sample> fast_poisson_disk_surface(const std::vector<vec3>& vertices, const std::vector<std::uint32_t>& indices,
+                                                                        float r, int k = 30, statistics* stats = nullptr) {
+        xoshiro128 generator { std::random_device { }() };
+        return fast_poisson_disk_surface<Policy>(vertices, indices, r, k, generator, stats);
+    }
+
+
+
+    // Scalar field sampled on a regular lattice spanning a domain, interpolated multilinearly between lattice points
+    // (e.g. a density map used as the radius of fast_poisson_disk_variable).
+    template <std::size_t N>
+    class sampled_field {
+        public:
+            // 'dimensions' - extent of the domain, spanned by the lattice from its first to its last point along each axis.
+            // 'resolution' - number of lattice points along each axis (at least 2).
+            // 'values' - value at every lattice point, with the first axis varying fastest.
+            sampled_field(const point<N>& dimensions, const cell<N>& resolution, std::vector<float> values)
+                    : resolution(resolution),
+                      strides(),
+                      scale(),
+                      values(std::move(values)) {
+                int stride = 1;
+                for (std::size_t i = 0; i < N; ++i) {
+                    strides[i] = stride;
+                    stride *= resolution[i];
+                    scale[i] = static_cast<float>(resolution[i] - 1) / dimensions[i];
+                }
+            }
+
+            // Value at 'position', clamped to the domain.
+            [[nodiscard]] float operator()(const point<N>& position) const {
+                cell<N> base;
+                point<N> fraction;
+                for (std::size_t i = 0; i < N; ++i) {
+                    float coordinate = std::clamp(position[i] * scale[i], 0.0f, static_cast<float>(resolution[i] - 1));
+                    base[i] = std::min(static_cast<int>(coordinate), resolution[i] - 2);
+                    fraction[i] = coordinate - static_cast<float>(base[i]);
+                }
+
+                float result = 0.0f;
+                for (int corner = 0; corner < (1 << N); ++corner) {
+                    float weight = 1.0f;
+                    int index = 0;
+                    for (std::size_t i = 0; i < N; ++i) {
+                        int bit = (corner >> i) & 1;
+                        weight *= bit ? fraction[i] : 1.0f - fraction[i];
+                        index += (base[i] + bit) * strides[i];
+                    }
+                    result += weight * values[index];
+                }
+                return result;
+            }
+
+        private:
+            cell<N> resolution;
+            cell<N> strides;
+            point<N> scale; // Lattice spacings per unit of distance.
+            std::vector<float> values;
+    };
+
+    // Variable radius Fast Poisson Disk Sampling algorithm, for N-dimensional applications (2 <= N <= 8).
+    // Every sample 'x' has its own radius 'radius(x)', clamped to [r_min, r_max], and two samples are kept no closer
+    // than the smaller of their radii, so density follows the radius field (smoothly varying fields give the usual
+    // blue noise locally). Candidates are generated between 'radius(x)' and '2 radius(x)' around the expanded sample.
+    // Samples are recorded in one grid per power-of-two range of radii ("level"), with cells sized for the level, so a
+    // candidate only visits cells within the smaller of its radius and twice the level's smallest radius: sparse
+    // regions never scan the fine grids over a large neighborhood. Every level grid spans the whole domain and uses 4
+    // bytes per cell, so memory is dominated by the finest level, as with a uniform grid for 'r_min'.
+    // 'radius' - callable taking a point<N> and returning the radius at that point (see sampled_field).
+    // 'r_min', 'r_max' - bounds of the radius over the domain.
+    // 'k' - limit of samples to try before sample rejection (30 is the value provided by the paper).
+    // 'generator' - source of randomness (any UniformRandomBitGenerator), owned by the caller.
+    // 'stats' - optional output for counters describing the run.
+    // 'Policy' - order in which active samples are expanded.
+    template <std::size_t N, typename Policy = random_selection, typename Radius, typename URBG, typename = detail::enable_if_generator<URBG>>
+    [[nodiscard]] std::vector<point<N>> fast_poisson_disk_variable(const point<N>& dimensions, Radius&& radius, float r_min, float r_max, int k,
+                                                                   URBG& generator, statistics* stats = nullptr) {
+        // Level 'l' holds samples with radii in [r_min 2^l, r_min 2^(l + 1)), which lie at least r_min 2^l apart: grid
+        // cells sized for that distance hold at most one sample.
+        std::vector<float> level_radii { r_min };
+        while (level_radii.size() < 32 && 2.0f * level_radii.back() <= r_max) {
+            level_radii.emplace_back(2.0f * level_radii.back());
+        }
+
+        std::vector<grid<N, index_storage>> levels;
+        for (float level_radius : level_radii) {
+            levels.emplace_back(dimensions, level_radius);
+        }
+
+        detail::random_stream<URBG> random { generator };
+        typename Policy::template active_list<N> active_list { levels.front().grid_dimensions };
+
+        std::vector<point<N>> samples;
+        std::vector<float> radii;
+
+        auto radius_at = [&](const point<N>& position) {
+            return std::clamp(static_cast<float>(radius(position)), r_min, r_max);
+        };
+
+        // Returns whether any recorded sample lies closer to 'candidate' than the smaller of their radii.
+        auto conflicts = [&](const point<N>& candidate, float candidate_radius) {
+            for (std::size_t level = 0; level < levels.size(); ++level) {
+                const grid<N, index_storage>& g = levels[level];
+                float reach = std::min(candidate_radius, 2.0f * level_radii[level]);
+
+                cell<N> first;
+                cell<N> last;
+                for (std::size_t i = 0; i < N; ++i) {
+                    first[i] = std::max(static_cast<int>(std::floor((candidate[i] - reach) / g.cell_size)), 0);
+                    last[i] = std::min(static_cast<int>(std::floor((candidate[i] + reach) / g.cell_size)), g.grid_dimensions[i] - 1);
+                }
+
+                cell<N> coordinates = first;
+                while (true) {
+                    int existing_sample = g.grid_data[g.index(coordinates)];
+                    if (existing_sample != NO_SAMPLE) {
+                        float separation = std::min(candidate_radius, radii[existing_sample]);
+                        if (distance2(samples[existing_sample], candidate) < separation * separation) {
+                            return true;
+                        }
+                    }
+
+                    // Next cell of the box, in row-major order.
+                    std::size_t axis = 0;
+                    while (axis < N && ++coordinates[axis] > last[axis]) {
+                        coordinates[axis] = first[axis];
+                        ++axis;
+                    }
+
+                    if (axis == N) {
+                        break;
+                    }
+                }
+            }
+            return false;
+        };
+
+        // Records a sample in the grid of its level, the active list and the output.
+        auto record = [&](const point<N>& sample_world_coordinates, float sample_radius) {
+            std::size_t level = 0;
+            while (level + 1 < levels.size() && sample_radius >= level_radii[level + 1]) {
+                ++level;
+            }
+
+            int sample_index = static_cast<int>(samples.size());
+            grid<N, index_storage>& g = levels[level];
+            g.insert(g.index(g.convert_to_grid_coordinates(sample_world_coordinates)), sample_world_coordinates, sample_index);
+
+            active_list.push(sample_index, levels.front().convert_to_grid_coordinates(sample_world_coordinates));
+            samples.emplace_back(sample_world_coordinates);
+            radii.emplace_back(sample_radius);
+        };
+
+        // Generate initial sample, randomly chosen uniformly from the given domain.
+        point<N> sample_world_coordinates;
+        for (std::size_t i = 0; i < N; ++i) {
+            sample_world_coordinates[i] = random.uniform(0.0f, dimensions[i]);
+        }
+        record(sample_world_coordinates, radius_at(sample_world_coordinates));
+
+        std::size_t candidates = 0;
+        std::size_t iterations = 0;
+
+        while (!active_list.empty()) {
+            ++iterations;
+
+            // Choose sample to expand from active sample list.
+            int selected = active_list.select(random);
+            sample_world_coordinates = samples[selected];
+            float sample_radius = radii[selected];
+
+            bool found_sample = false;
+
+            // Try up to 'k' times to find a valid point.
+            for (int attempt = 0; attempt < k && !found_sample; ++attempt) {
+                ++candidates;
+                point<N> test_sample_world_coordinates = detail::generate_around(random, sample_world_coordinates, sample_radius);
+
+                // Ensure offsetting point did not push it out of bounds.
+                bool in_bounds = true;
+                for (std::size_t i = 0; i < N; ++i) {
+                    in_bounds = in_bounds && test_sample_world_coordinates[i] >= 0.0f && test_sample_world_coordinates[i] < dimensions[i];
+                }
+                if (!in_bounds) {
+                    continue;
+                }
+
+                float test_radius = radius_at(test_sample_world_coordinates);
+                if (!conflicts(test_sample_world_coordinates, test_radius)) {
+                    record(test_sample_world_coordinates, test_radius);
+                    found_sample = true;
+                }
+            }
+
+            if (!found_sample) {
+                // Failed to find a valid point position after 'k' attempts.
+                active_list.retire();
+            }
+        }
+
+        if (stats) {
+            stats->samples = samples.size();
+            stats->candidates = candidates;
+            stats->iterations = iterations;
+        }
+
+        return samples;
+    }
+
+    // Overload drawing from a generator local to the call, seeded non-deterministically.
+    template <std::size_t N, typename Policy = random_selection, typename Radius>
+    [[nodiscard]] std::vector<point<N>> fast_poisson_disk_variable(const point<N>& dimensions, Radius&& radius, float r_min, float r_max, int k = 30,
+                                                                   statistics* stats = nullptr) {
+        xoshiro128 generator { std::random_device { }() };
+        return fast_poisson_disk_variable<N, Policy>(dimensions, std::forward<Radius>(radius), r_min, r_max, k, generator, stats);
+    }
+
+    // Variable radius Fast Poisson Disk Sampling algorithm, for 2D applications (see fast_poisson_disk_variable).
+    // 'radius' - callable taking a vec2 and returning the radius at that point.
+    template <typename Policy = random_selection, typename Radius, typename URBG, typename = detail::enable_if_generator<URBG>>
+    [[nodiscard]] std::vector<vec2> fast_poisson_disk_variable_2d(vec2 dimensions, Radius&& radius, float r_min, float r_max, int k, URBG& generator,
+                                                                  statistics* stats = nullptr) {
+        std::vector<point<2>> samples = fast_poisson_disk_variable<2, Policy>({ dimensions.x, dimensions.y }, [&](const point<2>& position) {
+            return radius(vec2 { position[0], position[1] });
+        }, r_min, r_max, k, generator, stats);
+
+        std::vector<vec2> point_list;
+        point_list.reserve(samples.size());
+        for (const point<2>& sample : samples) {
+            point_list.emplace_back(sample[0], sample[1]);
+        }
+
+        return point_list;
+    }
+
+    // Overload drawing from a generator local to the call, seeded non-deterministically.
+    template <typename Policy = random_selection, typename Radius>
+    [[nodiscard]] std::vector<vec2> fast_poisson_disk_variable_2d(vec2 dimensions, Radius&& radius, float r_min, float r_max, int k = 30,
+                                                                  statistics* stats = nullptr) {
+        xoshiro128 generator { std::random_device { }() };
+        return fast_poisson_disk_variable_2d<Policy>(dimensions, std::forward<Radius>(radius), r_min, r_max, k, generator, stats);
+    }
+
+    // Variable radius Fast Poisson Disk Sampling algorithm, for 3D applications (see fast_poisson_disk_variable).
+    // 'radius' - callable taking a vec3 and returning the radius at that point.
+    template <typename Policy = random_selection, typename Radius, typename URBG, typename = detail::enable_if_generator<URBG>>
+    [[nodiscard]] std::vector<vec3> fast_poisson_disk_variable_3d(vec3 dimensions, Radius&& radius, float r_min, float r_max, int k, URBG& generator,
+                                                                  statistics* stats = nullptr) {
+        std::vector<point<3>> samples = fast_poisson_disk_variable<3, Policy>({ dimensions.x, dimensions.y, dimensions.z }, [&](const point<3>& position) {
+            return radius(vec3 { position[0], position[1], position[2] });
+        }, r_min, r_max, k, generator, stats);
+
+        std::vector<vec3> point_list;
+        point_list.reserve(samples.size());
+        for (const point<3>& sample : samples) {
+            point_list.emplace_back(sample[0], sample[1], sample[2]);
+        }
+
+        return point_list;
+    }
+
+    // Overload drawing from a generator local to the call, seeded non-deterministically.
+    template <typename Policy = random_selection, typename Radius>
+    [[nodiscard]] std::vector<vec3> fast_poisson_disk_variable_3d(vec3 dimensions, Radius&& radius, float r_min, float r_max, int k = 30,
+                                                                  statistics* stats = nullptr) {
+        xoshiro128 generator { std::random_device { }() };
+        return fast_poisson_disk_variable_3d<Policy>(dimensions, std::forward<Radius>(radius), r_min, r_max, k, generator, stats);
+    }
+
+
+
+    // Fixed set of threads running batches of independent jobs. Jobs are dealt out evenly, and threads that run out of
+    // jobs steal from the others, so a batch takes as long as the average load rather than the heaviest one.
+    class thread_pool {
+        public:
+            // 'threads' - number of threads running jobs, including the calling thread (0 for one per hardware thread).
+            explicit thread_pool(unsigned threads = 0)
+                    : queues(threads ? threads : std::max(1u, std::thread::hardware_concurrency())),
+                      context(nullptr),
+                      invoke(nullptr),
+                      generation(0),
+                      busy(0),
+                      stopping(false) {
+                for (unsigned thread = 1; thread < size(); ++thread) {
+                    workers.emplace_back([this, thread] { work(thread); });
+                }
+            }
+
+            ~thread_pool() {
+                {
+                    std::lock_guard<std::mutex> lock { mutex };
+                    stopping = true;
+                }
+                wake.notify_all();
+
+                for (std::thread& worker : workers) {
+                    worker.join();
+                }
+            }
+
+            thread_pool(const thread_pool&) = delete;
+            thread_pool& operator=(const thread_pool&) = delete;
+
+            [[nodiscard]] unsigned size() const {
+                return static_cast<unsigned>(queues.size());
+            }
+
+            // Calls job(index, thread) for every index in [0, count), where 'thread' in [0, size()) identifies the thread
+            // running the job. The calling thread runs jobs as thread 0. Returns once every job has completed. Jobs must
+            // not throw.
+            template <typename Job>
+            void run(std::size_t count, Job& job) {
+                for (std::size_t index = 0; index < count; ++index) {
+                    queues[index % size()].jobs.push_back(index);
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock { mutex };
+                    context = &job;
+                    invoke = [](void* job, std::size_t index, unsigned thread) {
+                        (*static_cast<Job*>(job))(index, thread);
+                    };
+                    busy = size() - 1;
+                    ++generation;
+                }
+                wake.notify_all();
+
+                drain(0);
+
+                std::unique_lock<std::mutex> lock { mutex };
+                done.wait(lock, [this] { return busy == 0; });
+            }
+
+        private:
+            struct queue {
+                std::mutex mutex;
+                std::deque<std::size_t> jobs;
+            };
+
+            // Owners take jobs from the front of their queue, and thieves from the back.
+            [[nodiscard]] bool pop(unsigned thread, std::size_t& index) {
+                for (unsigned i = 0; i < size(); ++i) {
+                    queue& victim = queues[(thread + i) % size()];
+
+                    std::lock_guard<std::mutex> lock { victim.mutex };
+                    if (victim.jobs.empty()) {
+                        continue;
+                    }
+
+                    if (i == 0) {
+                        index = victim.jobs.front();
+                        victim.jobs.pop_front();
+                    }
+                    else {
+                        index = victim.jobs.back();
+                        victim.jobs.pop_back();
+                    }
+                    return true;
+                }
+                return false;
+            }
+
+            // Runs jobs until none are left in any queue. No jobs are added while a batch runs, so a thread returning
+            // from here never has more work to do in the current batch.
+            void drain(unsigned thread) {
+                std::size_t index;
+                while (pop(thread, index)) {
+                    invoke(context, index, thread);
+                }
+            }
+
+            void work(unsigned thread) {
+                std::uint64_t seen = 0;
+
+                while (true) {
+                    {
+                        std::unique_lock<std::mutex> lock { mutex };
+                        wake.wait(lock, [&] { return stopping || generation != seen; });
+                        if (stopping) {
+                            return;
+                        }
+                        seen = generation;
+                    }
+
+                    drain(thread);
+
+                    {
+                        std::lock_guard<std::mutex> lock { mutex };
+                        --busy;
+                    }
+                    done.notify_one();
+                }
+            }
+
+            std::vector<queue> queues; // One per thread.
+            std::vector<std::thread> workers;
+
+            // Current batch.
+            void* context;
+            void (*invoke)(void*, std::size_t, unsigned);
+
+            std::mutex mutex;
+            std::condition_variable wake;
+            std::condition_variable done;
+            std::uint64_t generation;
+            unsigned busy; // Number of worker threads yet to finish the current batch.
+            bool stopping;
+    };
+
+    namespace detail {
+
+        // Number of cells spanned by the generation radius '2r', i.e. ceil(2 sqrt(N)).
+        [[nodiscard]] constexpr int generation_reach(std::size_t N) {
+            int reach = 1;
+            while (reach * reach < 4 * static_cast<int>(N)) {
+                ++reach;
+            }
+            return reach;
+        }
+
+        // Decomposition of a grid into square (cubic) tiles for phase-parallel sampling; the last tile along each axis
+        // may be smaller. Tiles are assigned to one of 2^N phases by the parity of their coordinates, so two tiles of the
+        // same phase are always separated by at least one whole tile of another phase.
+        //
+        // A tile only reads cells within 'halo' of itself, and only writes its own cells (or, from rounding at its
+        // boundary, the cells just outside it). Tiles wider than the halo therefore never access cells written by
+        // another tile of the same phase, and samples they generate concurrently lie more than 'r' apart.
+        template <std::size_t N>
+        struct tiling {
+            static constexpr int halo = generation_reach(N);
+            static constexpr int minimum_tile_cells = halo + 1;
+            static constexpr std::size_t minimum_phase_tiles = 64;
+
+            // Tiles of ~64K cells keep the halo overhead (re-expanding samples of neighboring tiles) low, and are
+            // shrunk as needed to give every phase enough tiles to keep many threads busy. The decomposition only
+            // depends on the grid, never on the number of threads, so neither does the generated point set.
+            explicit tiling(const cell<N>& grid_dimensions) : grid_dimensions(grid_dimensions), tile_cells(), tile_counts(), phases(std::size_t(1) << N) {
+                tile_cells = std::max(minimum_tile_cells, static_cast<int>(std::round(std::pow(65536.0, 1.0 / static_cast<double>(N)))));
+                while (tile_cells > minimum_tile_cells && tile_count(tile_cells) < (minimum_phase_tiles << N)) {
+                    --tile_cells;
+                }
+
+                int count = 1;
+                for (std::size_t i = 0; i < N; ++i) {
+                    tile_counts[i] = (grid_dimensions[i] + tile_cells - 1) / tile_cells;
+                    count *= tile_counts[i];
+                }
+
+                for (int tile = 0; tile < count; ++tile) {
+                    cell<N> coordinates = tile_coordinates(tile);
+
+                    std::size_t phase = 0;
+                    for (std::size_t i = 0; i < N; ++i) {
+                        phase |= static_cast<std::size_t>(coordinates[i] & 1) << i;
+                    }
+                    phases[phase].emplace_back(tile);
+                }
+            }
+
+            [[nodiscard]] cell<N> tile_coordinates(int tile) const {
+                cell<N> result { };
+                for (std::size_t i = 0; i < N; ++i) {
+                    result[i] = tile % tile_counts[i];
+                    tile /= tile_counts[i];
+                }
+                return result;
+            }
+
+            // Grid cells [first, last) covered by 'tile'.
+            void cells(int tile, cell<N>& first, cell<N>& last) const {
+                cell<N> coordinates = tile_coordinates(tile);
+                for (std::size_t i = 0; i < N; ++i) {
+                    first[i] = coordinates[i] * tile_cells;
+                    last[i] = std::min(first[i] + tile_cells, grid_dimensions[i]);
+                }
+            }
+
+            [[nodiscard]] std::size_t size() const {
+                std::size_t count = 0;
+                for (const std::vector<int>& phase : phases) {
+                    count += phase.size();
+                }
+                return count;
+            }
+
+            cell<N> grid_dimensions;
+            int tile_cells;
+            cell<N> tile_counts;
+            std::vector<std::vector<int>> phases; // Tiles of each phase, in increasing order.
+
+            private:
+                [[nodiscard]] std::size_t tile_count(int cells) const {
+                    std::size_t count = 1;
+                    for (std::size_t i = 0; i < N; ++i) {
+                        count *= static_cast<std::size_t>((grid_dimensions[i] + cells - 1) / cells);
+                    }
+                    return count;
+                }
+        };
+
+        // Fills the tile [lower, upper) of the grid, spanning cells [first, last), with samples, storing them in
+        // 'output'. Samples recorded within '2r' of the tile (by neighboring tiles) seed its active list, so generation
+        // continues across tile boundaries as if the domain were sampled in one pass. Without any, generation starts
+        // from a random sample.
+        template <std::size_t N, typename Policy, typename URBG>
+        void sample_tile(grid<N, coordinate_storage>& g, const cell<N>& first, const cell<N>& last, const point<N>& lower,
+                         const point<N>& upper, float r, int k, URBG& generator, std::vector<point<N>>& output, statistics& stats) {
+            random_stream<URBG> random { generator };
+            float r2 = r * r;
+
+            // Region of the grid read while sampling the tile.
+            cell<N> region_first;
+            cell<N> region_dimensions;
+            int region_size = 1;
+
+            for (std::size_t i = 0; i < N; ++i) {
+                region_first[i] = std::max(first[i] - generation_reach(N), 0);
+                region_dimensions[i] = std::min(last[i] + generation_reach(N), g.grid_dimensions[i]) - region_first[i];
+                region_size *= region_dimensions[i];
+            }
+
+            typename Policy::template active_list<N> active_list { region_dimensions };
+
+            // Samples are indexed locally: seeds from neighboring tiles first, followed by the samples of this tile.
+            std::vector<point<N>> point_list;
+
+            for (int offset = 0; offset < region_size; ++offset) {
+                cell<N> grid_coordinates;
+                cell<N> region_coordinates;
+
+                int remainder = offset;
+                for (std::size_t i = 0; i < N; ++i) {
+                    region_coordinates[i] = remainder % region_dimensions[i];
+                    grid_coordinates[i] = region_first[i] + region_coordinates[i];
+                    remainder /= region_dimensions[i];
+                }
+
+                int cell_index = g.index(grid_coordinates);
+                if (g.empty(cell_index)) {
+                    continue;
+                }
+
+                // Only samples within '2r' of the tile can generate candidates inside it.
+                const point<N>& sample = g.grid_samples[cell_index];
+                float gap2 = 0.0f;
+                for (std::size_t i = 0; i < N; ++i) {
+                    float gap = std::max({ lower[i] - sample[i], sample[i] - upper[i], 0.0f });
+                    gap2 += gap * gap;
+                }
+
+                if (gap2 < 4.0f * r2) {
+                    active_list.push(static_cast<int>(point_list.size()), region_coordinates);
+                    point_list.emplace_back(sample);
+                }
+            }
+
+            std::size_t seeds = point_list.size();
+            candidate_batch<N> batch;
+
+            // Records the sample in 'lane' of the current batch.
+            auto record = [&](int lane) {
+                point<N> sample_world_coordinates = batch.get(lane);
+                cell<N> sample_grid_coordinates = g.convert_to_grid_coordinates(sample_world_coordinates);
+                g.insert(g.index(sample_grid_coordinates), sample_world_coordinates, NO_SAMPLE);
+
+                for (std::size_t i = 0; i < N; ++i) {
+                    sample_grid_coordinates[i] -= region_first[i];
+                }
+
+                active_list.push(static_cast<int>(point_list.size()), sample_grid_coordinates);
+                point_list.emplace_back(sample_world_coordinates);
+            };
+
+            if (active_list.empty()) {
+                // Generate initial sample, randomly chosen uniformly from the tile.
+                for (int attempt = 0; attempt < k; attempt += batch_size) {
+                    int count = std::min(batch_size, k - attempt);
+                    for (int lane = 0; lane < count; ++lane) {
+                        for (std::size_t axis = 0; axis < N; ++axis) {
+                            batch.coordinates[axis][lane] = random.uniform(lower[axis], upper[axis]);
+                        }
+                    }
+
+                    int lane = first_valid(g, batch, count, lower, upper, r2, point_list);
+                    if (lane >= 0) {
+                        record(lane);
+                        break;
+                    }
+                }
+            }
+
+            while (!active_list.empty()) {
+                ++stats.iterations;
+
+                // Choose sample to expand from active sample list.
+                point<N> sample_world_coordinates = point_list[active_list.select(random)];
+
+                bool found_sample = false;
+
+                // Try up to 'k' times to find a valid point inside the tile, in batches (see fast_poisson_disk).
+                for (int attempt = 0; attempt < k && !found_sample; attempt += batch_size) {
+                    int count = std::min(batch_size, k - attempt);
+
+                    for (int lane = 0; lane < count; ++lane) {
+                        point<N> test_sample_world_coordinates = generate_around(random, sample_world_coordinates, r);
+                        for (std::size_t axis = 0; axis < N; ++axis) {
+                            batch.coordinates[axis][lane] = test_sample_world_coordinates[axis];
+                        }
+                    }
+
+                    int lane = first_valid(g, batch, count, lower, upper, r2, point_list);
+                    if (lane < 0) {
+                        stats.candidates += count;
+                        continue;
+                    }
+
+                    stats.candidates += lane + 1;
+                    record(lane);
+                    found_sample = true;
+                }
+
+                if (!found_sample) {
+                    active_list.retire();
+                }
+            }
+
+            output.assign(point_list.begin() + static_cast<std::ptrdiff_t>(seeds), point_list.end());
+        }
+
+    }
+
+    // Parallel Fast Poisson Disk Sampling algorithm, for N-dimensional applications (2 <= N <= 8).
+    // The grid is split into tiles, sampled concurrently in 2^N phases such that tiles of the same phase never touch
+    // conflicting cells. The minimum distance 'r' is maintained across tile boundaries.
+    // 'r' - minimum distance to be maintained between final point samples.
+    // 'k' - limit of samples to try before sample rejection (30 is the value provided by the paper).
+    // 'generator' - source of randomness, used to seed a separate random stream for every tile.
+    // 'pool' - threads sampling the tiles, which may be shared between runs.
+    // 'stats' - optional output for counters describing the run.
+    // 'Policy' - order in which active samples are expanded within each tile.
+    // Samples are returned grouped by tile, in tile order. A tile only depends on its random stream and on the tiles
+    // of earlier phases, so the output is reproducible from the state of 'generator', bit for bit, whatever the number
+    // of threads. The grid always stores coordinates inline (see coordinate_storage), since concurrently sampled tiles
+    // have no shared output list to index into.
+    template <std::size_t N, typename Policy = random_selection, typename URBG, typename = detail::enable_if_generator<URBG>>
+    [[nodiscard]] std::vector<point<N>> fast_poisson_disk_parallel(const point<N>& dimensions, float r, int k, URBG& generator,
+                                                                   thread_pool& pool, statistics* stats = nullptr) {
+        grid<N, coordinate_storage> g { dimensions, r };
+        detail::tiling<N> tiles { g.grid_dimensions };
+
+        // Every tile draws from its own Philox stream, whichever thread it runs on.
+        std::uint64_t seed = (static_cast<std::uint64_t>(generator()) << 32) ^ static_cast<std::uint64_t>(generator());
+
+        std::vector<std::vector<point<N>>> tile_samples(tiles.size());
+        std::vector<statistics> tile_statistics(tiles.size());
+
+        for (const std::vector<int>& phase : tiles.phases) {
+            auto job = [&](std::size_t index, unsigned) {
+                int tile = phase[index];
+
+                cell<N> first;
+                cell<N> last;
+                tiles.cells(tile, first, last);
+
+                point<N> lower;
+                point<N> upper;
+                for (std::size_t i = 0; i < N; ++i) {
+                    lower[i] = static_cast<float>(first[i]) * g.cell_size;
+                    upper[i] = std::min(static_cast<float>(last[i]) * g.cell_size, dimensions[i]);
+                }
+
+                philox tile_generator { seed, static_cast<std::uint64_t>(tile) };
+                detail::sample_tile<N, Policy>(g, first, last, lower, upper, r, k, tile_generator, tile_samples[tile], tile_statistics[tile]);
+            };
+            pool.run(phase.size(), job);
+        }
+
+        std::size_t total = 0;
+        for (const std::vector<point<N>>& samples : tile_samples) {
+            total += samples.size();
+        }
+
+        std::vector<point<N>> point_list;
+        point_list.reserve(total);
+        for (const std::vector<point<N>>& samples : tile_samples) {
+            point_list.insert(point_list.end(), samples.begin(), samples.end());
+        }
+
+        if (stats) {
+            *stats = statistics { };
+            for (const statistics& tile : tile_statistics) {
+                stats->candidates += tile.candidates;
+                stats->iterations += tile.iterations;
+            }
+            stats->samples = point_list.size();
+        }
+
+        return point_list;
+    }
+
+    // Overload running on a thread pool local to the call.
+    // 'threads' - number of threads to use (0 for one per hardware thread).
+    template <std::size_t N, typename Policy = random_selection, typename URBG, typename = detail::enable_if_generator<URBG>>
+    [[nodiscard]] std::vector<point<N>> fast_poisson_disk_parallel(const point<N>& dimensions, float r, int k, URBG& generator,
+                                                                   unsigned threads = 0, statistics* stats = nullptr) {
+        thread_pool pool { threads };
+        return fast_poisson_disk_parallel<N, Policy>(dimensions, r, k, generator, pool, stats);
+    }
+
+    // Overload drawing from generators local to the call, seeded non-deterministically.
+    template <std::size_t N, typename Policy = random_selection>
+    [[nodiscard]] std::vector<point<N>> fast_poisson_disk_parallel(const point<N>& dimensions, float r, int k = 30, unsigned threads = 0,
+                                                                   statistics* stats = nullptr) {
+        xoshiro128 generator { std::random_device { }() };
+        return fast_poisson_disk_parallel<N, Policy>(dimensions, r, k, generator, threads, stats);
+    }
+
+    // Parallel Fast Poisson Disk Sampling algorithm, for 2D applications (see fast_poisson_disk_parallel).
+    template <typename Policy = random_selection, typename URBG, typename = detail::enable_if_generator<URBG>>
+    [[nodiscard]] std::vector<vec2> fast_poisson_disk_parallel_2d(vec2 dimensions, float r, int k, URBG& generator, unsigned threads = 0,
+                                                                  statistics* stats = nullptr) {
+        std::vector<point<2>> samples = fast_poisson_disk_parallel<2, Policy>({ dimensions.x, dimensions.y }, r, k, generator, threads, stats);
+
+        std::vector<vec2> point_list;
+        point_list.reserve(samples.size());
+        for (const point<2>& sample : samples) {
+            point_list.emplace_back(sample[0], sample[1]);
+        }
+
+        return point_list;
+    }
+
+    // Overload drawing from generators local to the call, seeded non-deterministically.
+    template <typename Policy = random_selection>
+    [[nodiscard]] std::vector<vec2> fast_poisson_disk_parallel_2d(vec2 dimensions, float r, int k = 30, unsigned threads = 0, statistics* stats = nullptr) {
+        xoshiro128 generator { std::random_device { }() };
+        return fast_poisson_disk_parallel_2d<Policy>(dimensions, r, k, generator, threads, stats);
+    }
+
+    // Parallel Fast Poisson Disk Sampling algorithm, for 3D applications (see fast_poisson_disk_parallel).
+    template <typename Policy = random_selection, typename URBG, typename = detail::enable_if_generator<URBG>>
+    [[nodiscard]] std::vector<vec3> fast_poisson_disk_parallel_3d(vec3 dimensions, float r, int k, URBG& generator, unsigned threads = 0,
+                                                                  statistics* stats = nullptr) {
+        std::vector<point<3>> samples = fast_poisson_disk_parallel<3, Policy>({ dimensions.x, dimensions.y, dimensions.z }, r, k, generator, threads, stats);
+
+        std::vector<vec3> point_list;
+        point_list.reserve(samples.size());
+        for (const point<3>& sample : samples) {
+            point_list.emplace_back(sample[0], sample[1], sample[2]);
+        }
+
+        return point_list;
+    }
+
+    // Overload drawing from generators local to the call, seeded non-deterministically.
+    template <typename Policy = random_selection>
+    [[nodiscard]] std::vector<vec3> fast_poisson_disk_parallel_3d(vec3 dimensions, float r, int k = 30, unsigned threads = 0, statistics* stats = nullptr) {
+        xoshiro128 generator { std::random_device { }() };
+        return fast_poisson_disk_parallel_3d<Policy>(dimensions, r, k, generator, threads, stats);
+    }
+
+
+
+
+    namespace detail {
+
+        // Grid shared by threads inserting samples concurrently, without locks. Every cell holds an atomic state next to
+        // its inline coordinates (see coordinate_storage). A thread first claims a cell (empty -> pending) with a
+        // compare-and-swap, then checks the neighborhood again and either commits the sample (pending -> committed) or
+        // releases the cell (pending -> empty). Pending neighbors count as conflicts, so of two threads inserting
+        // conflicting samples at the same time, at least one sees the other's claim and backs off.
+        template <std::size_t N>
+        struct concurrent_grid {
+            enum : std::uint8_t {
+                empty_cell,
+                pending_cell,
+                committed_cell
+            };
+
+            concurrent_grid(const point<N>& dimensions, float separation_distance)
+                    : layout(dimensions, separation_distance),
+                      states(static_cast<std::size_t>(layout.grid_size)) {
+            }
+
+            // Returns whether any pending sample, or committed sample closer than 'r' to 'sample', is recorded in the
+            // conflict stencil around 'cell_index'.
+            [[nodiscard]] bool conflicts(int cell_index, const point<N>& sample, float r2, std::memory_order order) const {
+                for (int neighbor_offset : layout.neighbor_offsets) {
+                    int neighbor = cell_index + neighbor_offset;
+
+                    std::uint8_t state = states[neighbor].load(order);
+                    if (state == pending_cell) {
+                        return true;
+                    }
+
+                    // Coordinates are written before the state is published, and never change afterwards.
+                    if (state == committed_cell && distance2(layout.grid_samples[neighbor], sample) < r2) {
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            // Records 'sample' if its cell is empty and it lies no closer than 'r' to any other sample, returning whether
+            // it was recorded.
+            [[nodiscard]] bool try_insert(const point<N>& sample, float r2) {
+                int cell_index = layout.index(layout.convert_to_grid_coordinates(sample));
+
+                // Most candidates are rejected here, without writing to shared memory.
+                if (states[cell_index].load(std::memory_order_acquire) != empty_cell ||
+                    conflicts(cell_index, sample, r2, std::memory_order_acquire)) {
+                    return false;
+                }
+
+                std::uint8_t expected = empty_cell;
+                if (!states[cell_index].compare_exchange_strong(expected, pending_cell, std::memory_order_seq_cst)) {
+                    return false;
+                }
+
+                // Sequentially consistent loads after the (sequentially consistent) claim: of two threads claiming
+                // conflicting cells, the one claiming last is guaranteed to observe the other claim.
+                if (conflicts(cell_index, sample, r2, std::memory_order_seq_cst)) {
+                    states[cell_index].store(empty_cell, std::memory_order_release);
+                    return false;
+                }
+
+                layout.grid_samples[cell_index] = sample;
+                states[cell_index].store(committed_cell, std::memory_order_release);
+                return true;
+            }
+
+            grid<N, coordinate_storage> layout; // Cell geometry and sample coordinates.
+            std::vector<std::atomic<std::uint8_t>> states;
+        };
+
+        // Active samples of one worker of the concurrent sampler. Workers expand their own samples and steal half of
+        // another worker's list once their own runs dry.
+        template <std::size_t N>
+        struct shared_active_list {
+            std::mutex mutex;
+            std::vector<point<N>> samples;
+        };
+
+    }
+
+    // Concurrent Fast Poisson Disk Sampling algorithm, for N-dimensional applications (2 <= N <= 8).
+    // Every thread of 'pool' expands active samples into one shared grid, claiming cells with compare-and-swap (see
+    // detail::concurrent_grid), and idle threads steal active samples from busy ones. Unlike the tiled sampler there is
+    // no decomposition of the domain to balance, which suits irregular domains and high thread counts.
+    // 'r' - minimum distance to be maintained between final point samples.
+    // 'k' - limit of samples to try before sample rejection (30 is the value provided by the paper).
+    // 'generator' - source of randomness, used to seed a separate random stream for every thread of 'pool'.
+    // 'pool' - threads throwing darts, which may be shared between runs.
+    // 'stats' - optional output for counters describing the run.
+    // Active samples are expanded in random order. Samples are returned grouped by the thread that generated them, and
+    // depend on thread scheduling.
+    template <std::size_t N, typename URBG, typename = detail::enable_if_generator<URBG>>
+    [[nodiscard]] std::vector<point<N>> fast_poisson_disk_concurrent(const point<N>& dimensions, float r, int k, URBG& generator,
+                                                                     thread_pool& pool, statistics* stats = nullptr) {
+        detail::concurrent_grid<N> g { dimensions, r };
+        float r2 = r * r;
+        unsigned workers = pool.size();
+
+        std::uint64_t seed = (static_cast<std::uint64_t>(generator()) << 32) ^ static_cast<std::uint64_t>(generator());
+
+        std::vector<philox> generators;
+        for (unsigned worker = 0; worker < workers; ++worker) {
+            generators.emplace_back(seed, worker);
+        }
+
+        std::vector<detail::shared_active_list<N>> active_lists(workers);
+        std::vector<std::vector<point<N>>> worker_samples(workers);
+        std::vector<statistics> worker_statistics(workers);
+
+        // Number of active samples, in any list or being expanded. Incremented before a new sample is pushed and
+        // decremented once a sample is retired, so it only reaches zero once sampling has finished.
+        std::atomic<std::size_t> active { 0 };
+
+        // Every worker starts from a sample chosen uniformly from the domain.
+        for (unsigned worker = 0; worker < workers; ++worker) {
+            detail::random_stream<philox> random { generators[worker] };
+
+            for (int attempt = 0; attempt < k; ++attempt) {
+                point<N> sample_world_coordinates;
+                for (std::size_t i = 0; i < N; ++i) {
+                    sample_world_coordinates[i] = random.uniform(0.0f, dimensions[i]);
+                }
+
+                if (g.try_insert(sample_world_coordinates, r2)) {
+                    worker_samples[worker].emplace_back(sample_world_coordinates);
+                    active_lists[worker].samples.emplace_back(sample_world_coordinates);
+                    active.fetch_add(1, std::memory_order_relaxed);
+                    break;
+                }
+            }
+        }
+
+        auto job = [&](std::size_t worker, unsigned) {
+            detail::random_stream<philox> random { generators[worker] };
+            detail::shared_active_list<N>& own = active_lists[worker];
+            statistics& counters = worker_statistics[worker];
+
+            // Removes a random sample from the worker's list, stealing half of another list first if it is empty.
+            auto take = [&](point<N>& sample) {
+                {
+                    std::lock_guard<std::mutex> lock { own.mutex };
+                    if (!own.samples.empty()) {
+                        std::size_t selected = static_cast<std::size_t>(random.index(static_cast<int>(own.samples.size())));
+                        sample = own.samples[selected];
+                        own.samples[selected] = own.samples.back();
+                        own.samples.pop_back();
+                        return true;
+                    }
+                }
+
+                std::vector<point<N>> stolen;
+                for (unsigned i = 1; i < workers && stolen.empty(); ++i) {
+                    detail::shared_active_list<N>& victim = active_lists[(worker + i) % workers];
+
+                    std::lock_guard<std::mutex> lock { victim.mutex };
+                    std::size_t count = (victim.samples.size() + 1) / 2;
+                    stolen.assign(victim.samples.end() - static_cast<std::ptrdiff_t>(count), victim.samples.end());
+                    victim.samples.resize(victim.samples.size() - count);
+                }
+
+                if (stolen.empty()) {
+                    return false;
+                }
+
+                sample = stolen.back();
+                stolen.pop_back();
+
+                std::lock_guard<std::mutex> lock { own.mutex };
+                own.samples.insert(own.samples.end(), stolen.begin(), stolen.end());
+                return true;
+            };
+
+            while (true) {
+                point<N> sample_world_coordinates;
+                if (!take(sample_world_coordinates)) {
+                    if (active.load(std::memory_order_acquire) == 0) {
+                        break;
+                    }
+                    // Other workers are still expanding samples, which may produce more work.
+                    std::this_thread::yield();
+                    continue;
+                }
+
+                ++counters.iterations;
+                bool found_sample = false;
+
+                // Try up to 'k' times to find a valid point.
+                for (int attempt = 0; attempt < k && !found_sample; ++attempt) {
+                    ++counters.candidates;
+                    point<N> test_sample_world_coordinates = detail::generate_around(random, sample_world_coordinates, r);
+
+                    bool in_bounds = true;
+                    for (std::size_t i = 0; i < N; ++i) {
+                        in_bounds = in_bounds && test_sample_world_coordinates[i] >= 0.0f && test_sample_world_coordinates[i] < dimensions[i];
+                    }
+
+                    if (in_bounds && g.try_insert(test_sample_world_coordinates, r2)) {
+                        worker_samples[worker].emplace_back(test_sample_world_coordinates);
+                        active.fetch_add(1, std::memory_order_relaxed);
+
+                        // The expanded sample stays active alongside the new one.
+                        std::lock_guard<std::mutex> lock { own.mutex };
+                        own.samples.emplace_back(sample_world_coordinates);
+                        own.samples.emplace_back(test_sample_world_coordinates);
+
+                        found_sample = true;
+                    }
+                }
+
+                if (!found_sample) {
+                    active.fetch_sub(1, std::memory_order_release);
+                }
+            }
+        };
+        pool.run(workers, job);
+
+        std::size_t total = 0;
+        for (const std::vector<point<N>>& samples : worker_samples) {
+            total += samples.size();
+        }
+
+        std::vector<point<N>> point_list;
+        point_list.reserve(total);
+        for (const std::vector<point<N>>& samples : worker_samples) {
+            point_list.insert(point_list.end(), samples.begin(), samples.end());
+        }
+
+        if (stats) {
+            *stats = statistics { };
+            for (const statistics& worker : worker_statistics) {
+                stats->candidates += worker.candidates;
+                stats->iterations += worker.iterations;
+            }
+            stats->samples = point_list.size();
+        }
+
+        return point_list;
+    }
+
+    // Overload running on a thread pool local to the call.
+    // 'threads' - number of threads to use (0 for one per hardware thread).
+    template <std::size_t N, typename URBG, typename = detail::enable_if_generator<URBG>>
+    [[nodiscard]] std::vector<point<N>> fast_poisson_disk_concurrent(const point<N>& dimensions, float r, int k, URBG& generator,
+                                                                     unsigned threads = 0, statistics* stats = nullptr) {
+        thread_pool pool { threads };
+        return fast_poisson_disk_concurrent<N>(dimensions, r, k, generator, pool, stats);
+    }
+
+    // Overload drawing from generators local to the call, seeded non-deterministically.
+    template <std::size_t N>
+    [[nodiscard]] std::vector<point<N>> fast_poisson_disk_concurrent(const point<N>& dimensions, float r, int k = 30, unsigned threads = 0,
+                                                                     statistics* stats = nullptr) {
+        xoshiro128 generator { std::random_device { }() };
+        return fast_poisson_disk_concurrent<N>(dimensions, r, k, generator, threads, stats);
+    }
+
+    // Concurrent Fast Poisson Disk Sampling algorithm, for 2D applications (see fast_poisson_disk_concurrent).
+    template <typename URBG, typename = detail::enable_if_generator<URBG>>
+    [[nodiscard]] std::vector<vec2> fast_poisson_disk_concurrent_2d(vec2 dimensions, float r, int k, URBG& generator, unsigned threads = 0,
+                                                                    statistics* stats = nullptr) {
+        std::vector<point<2>> samples = fast_poisson_disk_concurrent<2>({ dimensions.x, dimensions.y }, r, k, generator, threads, stats);
+
+        std::vector<vec2> point_list;
+        point_list.reserve(samples.size());
+        for (const point<2>& sample : samples) {
+            point_list.emplace_back(sample[0], sample[1]);
+        }
+
+        return point_list;
+    }
+
+    // Overload drawing from generators local to the call, seeded non-deterministically.
+    [[nodiscard]] inline std::vector<vec2> fast_poisson_disk_concurrent_2d(vec2 dimensions, float r, int k = 30, unsigned threads = 0, statistics* stats = nullptr) {
+        xoshiro128 generator { std::random_device { }() };
+        return fast_poisson_disk_concurrent_2d(dimensions, r, k, generator, threads, stats);
+    }
+
+    // Concurrent Fast Poisson Disk Sampling algorithm, for 3D applications (see fast_poisson_disk_concurrent).
+    template <typename URBG, typename = detail::enable_if_generator<URBG>>
+    [[nodiscard]] std::vector<vec3> fast_poisson_disk_concurrent_3d(vec3 dimensions, float r, int k, URBG& generator, unsigned threads = 0,
+                                                                    statistics* stats = nullptr) {
+        std::vector<point<3>> samples = fast_poisson_disk_concurrent<3>({ dimensions.x, dimensions.y, dimensions.z }, r, k, generator, threads, stats);
+
+        std::vector<vec3> point_list;
+        point_list.reserve(samples.size());
+        for (const point<3>& sample : samples) {
+            point_list.emplace_back(sample[0], sample[1], sample[2]);
+        }
+
+        return point_list;
+    }
+
+    // Overload drawing from generators local to the call, seeded non-deterministically.
+    [[nodiscard]] inline std::vector<vec3> fast_poisson_disk_concurrent_3d(vec3 dimensions, float r, int k = 30, unsigned threads = 0, statistics* stats = nullptr) {
+        xoshiro128 generator { std::random_device { }() };
+        return fast_poisson_disk_concurrent_3d(dimensions, r, k, generator, threads, stats);
+    }
+
+
+
+    // Poisson disk sampling of an unbounded N-dimensional world (2 <= N <= 8), generated on demand in chunks.
+    // Chunk 'c' covers [c * chunk_size, (c + 1) * chunk_size) along each axis. Chunks follow the phases of the tiled
+    // sampler (see fast_poisson_disk_parallel): a chunk is generated after, and continues from, the adjacent chunks of
+    // earlier phases, which it generates first if needed. A query therefore only depends on a bounded neighborhood of
+    // chunks (at most 2^N - 1 chunks away along each axis), and every chunk is identical whichever chunk was queried
+    // first: together, chunks form a single point set maintaining the minimum distance 'r' across chunk borders.
+    // Recently used chunks are cached within a memory budget, and evicted chunks are generated again, identically, when
+    // needed. Not thread-safe.
+    template <std::size_t N, typename Policy = random_selection>
+    class world_sampler {
+        static_assert(N >= 2 && N <= 8, "fpds::world_sampler supports between 2 and 8 dimensions");
+
+        public:
+            // 'chunk_size' - side length of chunks, at least '2r' (asserted): narrower chunks of the same phase would
+            //                sample within 'r' of each other independently.
+            // 'r' - minimum distance to be maintained between final point samples.
+            // 'k' - limit of samples to try before sample rejection (30 is the value provided by the paper).
+            // 'seed' - world seed. Every chunk draws from its own Philox stream, derived from the seed and its coordinates.
+            // 'memory_budget' - bytes of samples to keep cached. The least recently used chunks are evicted beyond it,
+            // except for the chunk used last.
+            world_sampler(float chunk_size, float r, int k = 30, std::uint64_t seed = 0,
+                          std::size_t memory_budget = std::numeric_limits<std::size_t>::max())
+                    : chunk_size(chunk_size), r(r), k(k), seed(seed), memory_budget(memory_budget), memory_use(0) {
+                assert(r > 0.0f && chunk_size >= 2.0f * r && "fpds::world_sampler chunks must be at least 2r wide");
+            }
+
+            // Samples inside chunk 'coordinates', in world coordinates. The reference is valid until the next call.
+            [[nodiscard]] const std::vector<point<N>>& chunk(const cell<N>& coordinates) {
+                const std::vector<point<N>>& samples = acquire(coordinates);
+                evict();
+                return samples;
+            }
+
+            // Samples inside the box [lower, upper), in world coordinates. Only chunks overlapping the box are generated.
+            [[nodiscard]] std::vector<point<N>> query(const point<N>& lower, const point<N>& upper) {
+                std::vector<point<N>> result;
+
+                cell<N> first;
+                cell<N> last;
+                for (std::size_t i = 0; i < N; ++i) {
+                    first[i] = static_cast<int>(std::floor(lower[i] / chunk_size));
+                    last[i] = static_cast<int>(std::ceil(upper[i] / chunk_size));
+
+                    if (last[i] <= first[i]) {
+                        return result;
+                    }
+                }
+
+                cell<N> coordinates = first;
+                while (true) {
+                    for (const point<N>& sample : chunk(coordinates)) {
+                        bool inside = true;
+                        for (std::size_t i = 0; i < N; ++i) {
+                            inside = inside && sample[i] >= lower[i] && sample[i] < upper[i];
+                        }
+
+                        if (inside) {
+                            result.emplace_back(sample);
+                        }
+                    }
+
+                    // Next chunk of the range, in row-major order.
+                    std::size_t axis = 0;
+                    while (axis < N && ++coordinates[axis] >= last[axis]) {
+                        coordinates[axis] = first[axis];
+                        ++axis;
+                    }
+
+                    if (axis == N) {
+                        break;
+                    }
+                }
+
+                return result;
+            }
+
+            // Releases every cached chunk. Chunks generated again afterwards are identical.
+            void clear() {
+                chunks.clear();
+                recent.clear();
+                memory_use = 0;
+            }
+
+            // Bytes of samples currently cached.
+            [[nodiscard]] std::size_t cached_bytes() const {
+                return memory_use;
+            }
+
+        private:
+            struct cached_chunk {
+                std::vector<point<N>> samples;
+                typename std::list<cell<N>>::iterator position; // In 'recent'.
+            };
+
+            // Returns the samples of a chunk, generating it (and the chunks it depends on) if it is not cached. Nothing
+            // is evicted here, so references to the chunks read while generating stay valid.
+            [[nodiscard]] const std::vector<point<N>>& acquire(const cell<N>& coordinates) {
+                auto existing = chunks.find(coordinates);
+                if (existing != chunks.end()) {
+                    recent.splice(recent.begin(), recent, existing->second.position);
+                    return existing->second.samples;
+                }
+
+                // Adjacent chunks of earlier phases. Chunks further away lie at least '2r' from this one, beyond the reach
+                // of its candidates.
+                std::vector<const std::vector<point<N>>*> neighbors;
+                for (const cell<N>& offset : detail::adjacent_offsets<N>()) {
+                    cell<N> neighbor;
+                    for (std::size_t i = 0; i < N; ++i) {
+                        neighbor[i] = coordinates[i] + offset[i];
+                    }
+
+                    if (phase(neighbor) < phase(coordinates)) {
+                        neighbors.emplace_back(&acquire(neighbor));
+                    }
+                }
+
+                // The chunk is sampled in a local frame covering the chunk and the '2r' around it.
+                point<N> origin;
+                point<N> local_dimensions;
+                point<N> lower;
+                point<N> upper;
+
+                for (std::size_t i = 0; i < N; ++i) {
+                    origin[i] = static_cast<float>(coordinates[i]) * chunk_size - 2.0f * r;
+                    local_dimensions[i] = chunk_size + 4.0f * r;
+                    lower[i] = static_cast<float>(coordinates[i]) * chunk_size - origin[i];
+                    upper[i] = static_cast<float>(coordinates[i] + 1) * chunk_size - origin[i];
+                }
+
+                grid<N, coordinate_storage> g { local_dimensions, r };
+
+                for (const std::vector<point<N>>* neighbor : neighbors) {
+                    for (const point<N>& sample : *neighbor) {
+                        point<N> local;
+                        bool inside = true;
+                        for (std::size_t i = 0; i < N; ++i) {
+                            local[i] = sample[i] - origin[i];
+                            inside = inside && local[i] >= 0.0f && local[i] < local_dimensions[i];
+                        }
+
+                        if (inside) {
+                            g.insert(g.index(g.convert_to_grid_coordinates(local)), local, NO_SAMPLE);
+                        }
+                    }
+                }
+
+                cell<N> first;
+                cell<N> last;
+                for (std::size_t i = 0; i < N; ++i) {
+                    first[i] = static_cast<int>(std::floor(lower[i] / g.cell_size));
+                    last[i] = std::min(static_cast<int>(std::ceil(upper[i] / g.cell_size)), g.grid_dimensions[i]);
+                }
+
+                philox generator { seed, stream(coordinates) };
+                statistics stats;
+
+                std::vector<point<N>> samples;
+                detail::sample_tile<N, Policy>(g, first, last, lower, upper, r, k, generator, samples, stats);
+
+                for (point<N>& sample : samples) {
+                    for (std::size_t i = 0; i < N; ++i) {
+                        sample[i] += origin[i];
+                    }
+                }
+
+                memory_use += samples.size() * sizeof(point<N>);
+                recent.emplace_front(coordinates);
+
+                cached_chunk& cached = chunks[coordinates];
+                cached.samples = std::move(samples);
+                cached.position = recent.begin();
+                return cached.samples;
+            }
+
+            // Evicts the least recently used chunks until the cache fits its memory budget.
+            void evict() {
+                while (memory_use > memory_budget && recent.size() > 1) {
+                    auto least_recent = chunks.find(recent.back());
+                    memory_use -= least_recent->second.samples.size() * sizeof(point<N>);
+                    chunks.erase(least_recent);
+                    recent.pop_back();
+                }
+            }
+
+            [[nodiscard]] static std::size_t phase(const cell<N>& coordinates) {
+                std::size_t result = 0;
+                for (std::size_t i = 0; i < N; ++i) {
+                    result |= static_cast<std::size_t>(coordinates[i] & 1) << i;
+                }
+                return result;
+            }
+
+            // Philox stream of a chunk, mixing its coordinates with the SplitMix64 finalizer.
+            [[nodiscard]] static std::uint64_t stream(const cell<N>& coordinates) {
+                std::uint64_t result = 0;
+                for (std::size_t i = 0; i < N; ++i) {
+                    result ^= static_cast<std::uint32_t>(coordinates[i]);
+                    result += UINT64_C(0x9E3779B97F4A7C15);
+                    result = (result ^ (result >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+                    result = (result ^ (result >> 27)) * UINT64_C(0x94D049BB133111EB);
+                    result ^= result >> 31;
+                }
+                return result;
+            }
+
+            float chunk_size;
+            float r;
+            int k;
+            std::uint64_t seed;
+
+            std::size_t memory_budget;
+            std::size_t memory_use;
+
+            std::map<cell<N>, cached_chunk> chunks;
+            std::list<cell<N>> recent; // Cached chunks, most recently used first.
+    };
+
+
+
+    namespace detail {
+
+        // Samples the box [lower, upper) around the fixed samples 'constraints', keeping new samples at least 'r' away
+        // from them and continuing from those within '2r' of the box (see sample_tile). Returns the new samples only.
+        template <std::size_t N, typename Policy, typename URBG>
+        [[nodiscard]] std::vector<point<N>> sample_box(const point<N>& lower, const point<N>& upper, const std::vector<point<N>>& constraints,
+                                                       float r, int k, URBG& generator) {
+            // The box is sampled in a local frame covering the box and the '2r' around it.
+            point<N> origin;
+            point<N> local_dimensions;
+            point<N> local_lower;
+            point<N> local_upper;
+
+            for (std::size_t i = 0; i < N; ++i) {
+                origin[i] = lower[i] - 2.0f * r;
+                local_dimensions[i] = upper[i] - lower[i] + 4.0f * r;
+                local_lower[i] = lower[i] - origin[i];
+                local_upper[i] = upper[i] - origin[i];
+            }
+
+            grid<N, coordinate_storage> g { local_dimensions, r };
+
+            for (const point<N>& sample : constraints) {
+                point<N> local;
+                bool inside = true;
+                for (std::size_t i = 0; i < N; ++i) {
+                    local[i] = sample[i] - origin[i];
+                    inside = inside && local[i] >= 0.0f && local[i] < local_dimensions[i];
+                }
+
+                if (inside) {
+                    g.insert(g.index(g.convert_to_grid_coordinates(local)), local, NO_SAMPLE);
+                }
+            }
+
+            cell<N> first;
+            cell<N> last;
+            for (std::size_t i = 0; i < N; ++i) {
+                first[i] = static_cast<int>(std::floor(local_lower[i] / g.cell_size));
+                last[i] = std::min(static_cast<int>(std::ceil(local_upper[i] / g.cell_size)), g.grid_dimensions[i]);
+            }
+
+            statistics stats;
+            std::vector<point<N>> samples;
+            sample_tile<N, Policy>(g, first, last, local_lower, local_upper, r, k, generator, samples, stats);
+
+            for (point<N>& sample : samples) {
+                for (std::size_t i = 0; i < N; ++i) {
+                    sample[i] += origin[i];
+                }
+            }
+
+            return samples;
         }
 
-        return point_list;
     }
 
-}
\ No newline at end of file
+    // Set of Wang tiles holding 2D Poisson disk samples, baked once and assembled at runtime into point sets covering any
+    // region of the plane, without sampling (e.g. to scatter objects every frame). Every edge of the tiling has one of
+    // 'colors' colors, chosen by hashing its coordinates, and the set holds a tile for every combination of the colors
+    // of its four edges: assembling a region amounts to looking its tiles up and copying their samples.
+    //
+    // Samples of two tiles can only conflict within 'r' of the edge or corner they share, so tiles are built from shared
+    // parts. The samples within '2r' of a corner are the same for every corner of every tile, the samples within 'r' of
+    // an edge (away from its corners) only depend on the color of the edge and are shared by the tiles on either side,
+    // and the rest of each tile is sampled around those. Assembled tiles therefore maintain the minimum distance 'r'
+    // everywhere, with no gaps along tile borders. The corner samples repeat regularly, and density ripples slightly
+    // (by about a tenth) where the rest of each tile continues from the shared parts.
+    class wang_tile_set {
+        public:
+            // Bakes a complete tile set ('colors'^4 tiles). Returns an empty set (with no tiles) if 'tile_size' is below '5r',
+            // where the shared parts of a tile would overlap and could place samples closer than 'r', or if 'colors' is
+            // below 1.
+            // 'tile_size' - side length of tiles, at least '5r'. Larger tiles make repeated corners less noticeable.
+            // 'r' - minimum distance to be maintained between final point samples.
+            // 'colors' - number of edge colors (at least 1), trading tile count for variety.
+            // 'k' - limit of samples to try before sample rejection (30 is the value provided by the paper).
+            // 'generator' - source of randomness (any UniformRandomBitGenerator), owned by the caller.
+            // 'Policy' - order in which active samples are expanded while baking.
+            template <typename Policy = random_selection, typename URBG, typename = detail::enable_if_generator<URBG>>
+            [[nodiscard]] static wang_tile_set bake(float tile_size, float r, int colors, int k, URBG& generator) {
+                if (!(r > 0.0f && tile_size >= 5.0f * r) || colors < 1) {
+                    return wang_tile_set { tile_size, 0 };
+                }
+
+                wang_tile_set set { tile_size, colors };
+                float s = tile_size;
+
+                // Shared parts are sampled over a wider box than they keep, so that their samples lie amidst others
+                // rather than packing densely along the border of the part.
+                auto keep = [](std::vector<point<2>> samples, std::size_t axis, float extent) {
+                    samples.erase(std::remove_if(samples.begin(), samples.end(), [&](const point<2>& sample) {
+                        return sample[axis] < -extent || sample[axis] >= extent;
+                    }), samples.end());
+                    return samples;
+                };
+
+                // Samples within '2r' of a corner, relative to the corner.
+                std::vector<point<2>> corner = detail::sample_box<2, Policy>({ -3.0f * r, -3.0f * r }, { 3.0f * r, 3.0f * r }, { }, r, k, generator);
+                corner = keep(keep(std::move(corner), 0, 2.0f * r), 1, 2.0f * r);
+
+                // Samples within 'r' of an edge and '2r' away from its ends, relative to the lower end of the edge.
+                std::vector<std::vector<point<2>>> horizontal;
+                std::vector<std::vector<point<2>>> vertical;
+
+                std::vector<point<2>> horizontal_ends;
+                std::vector<point<2>> vertical_ends;
+                for (const point<2>& sample : corner) {
+                    horizontal_ends.push_back(sample);
+                    horizontal_ends.push_back({ sample[0] + s, sample[1] });
+                    vertical_ends.push_back(sample);
+                    vertical_ends.push_back({ sample[0], sample[1] + s });
+                }
+
+                for (int color = 0; color < colors; ++color) {
+                    horizontal.emplace_back(keep(detail::sample_box<2, Policy>({ 2.0f * r, -2.0f * r }, { s - 2.0f * r, 2.0f * r }, horizontal_ends, r, k,
+                                                                               generator), 1, r));
+                    vertical.emplace_back(keep(detail::sample_box<2, Policy>({ -2.0f * r, 2.0f * r }, { 2.0f * r, s - 2.0f * r }, vertical_ends, r, k,
+                                                                             generator), 0, r));
+                }
+
+                for (int tile = 0; tile < set.tile_count(); ++tile) {
+                    int west = tile % colors;
+                    int north = tile / colors % colors;
+                    int east = tile / (colors * colors) % colors;
+                    int south = tile / (colors * colors * colors);
+
+                    std::vector<point<2>> samples;
+
+                    // Adds the samples of a shared part, placed at ('x', 'y') (0 or the tile size along each axis), that
+                    // lie inside the tile. Relative coordinates decide, so that rounding never assigns a sample to both
+                    // tiles sharing it, or to neither.
+                    auto place = [&](const std::vector<point<2>>& part, float x, float y) {
+                        for (const point<2>& sample : part) {
+                            if ((x == 0.0f) == (sample[0] >= 0.0f) && (y == 0.0f) == (sample[1] >= 0.0f)) {
+                                samples.push_back({ sample[0] + x, sample[1] + y });
+                            }
+                        }
+                    };
+
+                    place(corner, 0.0f, 0.0f);
+                    place(corner, s, 0.0f);
+                    place(corner, 0.0f, s);
+                    place(corner, s, s);
+                    place(horizontal[south], 0.0f, 0.0f);
+                    place(horizontal[north], 0.0f, s);
+                    place(vertical[west], 0.0f, 0.0f);
+                    place(vertical[east], s, 0.0f);
+
+                    std::vector<point<2>> interior = detail::sample_box<2, Policy>({ r, r }, { s - r, s - r }, samples, r, k, generator);
+                    samples.insert(samples.end(), interior.begin(), interior.end());
+
+                    std::vector<vec2>& tile_samples = set.tiles[tile];
+                    tile_samples.reserve(samples.size());
+                    for (const point<2>& sample : samples) {
+                        tile_samples.emplace_back(sample[0], sample[1]);
+                    }
+                }
+
+                return set;
+            }
+
+            // Overload drawing from a generator local to the call, seeded non-deterministically.
+            template <typename Policy = random_selection>
+            [[nodiscard]] static wang_tile_set bake(float tile_size, float r, int colors = 2, int k = 30) {
+                xoshiro128 generator { std::random_device { }() };
+                return bake<Policy>(tile_size, r, colors, k, generator);
+            }
+
+            // Index of the tile covering [coordinates * tile_size, (coordinates + 1) * tile_size) in the tiling selected
+            // by 'seed'. Every seed gives a different arrangement of the same tiles. The set must not be empty.
+            [[nodiscard]] int tile_at(ivec2 coordinates, std::uint64_t seed = 0) const {
+                int south = edge_color(coordinates.x, coordinates.y, 0, seed);
+                int north = edge_color(coordinates.x, coordinates.y + 1, 0, seed);
+                int west = edge_color(coordinates.x, coordinates.y, 1, seed);
+                int east = edge_color(coordinates.x + 1, coordinates.y, 1, seed);
+                return ((south * colors + east) * colors + north) * colors + west;
+            }
+
+            // Samples of tile 'index', relative to its lower corner.
+            [[nodiscard]] const std::vector<vec2>& tile(int index) const {
+                return tiles[index];
+            }
+
+            [[nodiscard]] int tile_count() const {
+                return static_cast<int>(tiles.size());
+            }
+
+            // Returns whether the set holds no tiles, as baked from invalid parameters.
+            [[nodiscard]] bool empty() const {
+                return tiles.empty();
+            }
+
+            [[nodiscard]] float tile_size() const {
+                return side;
+            }
+
+            // Samples inside [lower, upper) of the tiling selected by 'seed', tile by tile. Empty for an empty set.
+            [[nodiscard]] std::vector<vec2> query(vec2 lower, vec2 upper, std::uint64_t seed = 0) const {
+                std::vector<vec2> result;
+                if (empty()) {
+                    return result;
+                }
+
+                int first_x = static_cast<int>(std::floor(lower.x / side));
+                int first_y = static_cast<int>(std::floor(lower.y / side));
+                int last_x = static_cast<int>(std::ceil(upper.x / side));
+                int last_y = static_cast<int>(std::ceil(upper.y / side));
+
+                for (int y = first_y; y < last_y; ++y) {
+                    for (int x = first_x; x < last_x; ++x) {
+                        float origin_x = static_cast<float>(x) * side;
+                        float origin_y = static_cast<float>(y) * side;
+                        const std::vector<vec2>& samples = tiles[tile_at({ x, y }, seed)];
+
+                        // Tiles inside the box are copied whole; only those on its border are clipped.
+                        if (origin_x >= lower.x && origin_y >= lower.y && origin_x + side <= upper.x && origin_y + side <= upper.y) {
+                            for (const vec2& sample : samples) {
+                                result.emplace_back(sample.x + origin_x, sample.y + origin_y);
+                            }
+                            continue;
+                        }
+
+                        for (const vec2& sample : samples) {
+                            vec2 position { sample.x + origin_x, sample.y + origin_y };
+                            if (position.x >= lower.x && position.x < upper.x && position.y >= lower.y && position.y < upper.y) {
+                                result.emplace_back(position);
+                            }
+                        }
+                    }
+                }
+
+                return result;
+            }
+
+        private:
+            wang_tile_set(float tile_size, int colors) : side(tile_size), colors(colors), tiles(static_cast<std::size_t>(colors * colors * colors * colors)) {
+            }
+
+            // Color of the horizontal ('axis' 0) or vertical ('axis' 1) edge starting at corner ('x', 'y'), mixing its
+            // coordinates with the SplitMix64 finalizer.
+            [[nodiscard]] int edge_color(int x, int y, int axis, std::uint64_t seed) const {
+                std::uint64_t result = seed;
+                for (std::uint64_t value : { static_cast<std::uint64_t>(static_cast<std::uint32_t>(x)),
+                                             static_cast<std::uint64_t>(static_cast<std::uint32_t>(y)), static_cast<std::uint64_t>(axis) }) {
+                    result ^= value;
+                    result += UINT64_C(0x9E3779B97F4A7C15);
+                    result = (result ^ (result >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+                    result = (result ^ (result >> 27)) * UINT64_C(0x94D049BB133111EB);
+                    result ^= result >> 31;
+                }
+                return static_cast<int>(result % static_cast<std::uint64_t>(colors));
+            }
+
+            float side;
+            int colors;
+            std::vector<std::vector<vec2>> tiles; // Indexed by edge colors (south, east, north, west), most significant first.
+    };
+
+
+
+    // Parameters of the run that generated a point set, recorded alongside it in point set files.
+    template <std::size_t N>
+    struct point_set_parameters {
+        point<N> dimensions { }; // Extent of the domain.
+        float r = 0.0f;          // Minimum distance between samples.
+        int k = 0;               // Limit of samples tried before sample rejection.
+        std::uint64_t seed = 0;  // Seed of the generator, as chosen by the caller.
+    };
+
+    namespace detail {
+
+        // Header of a point set file (version 1), followed by:
+        // - the coordinates of all samples along the first axis, then along the second, and so on, as float arrays
+        //   starting at multiples of 64 bytes;
+        // - optionally, a spatial index over a lattice of 2^index_bits cells per axis spanning the domain: the index of
+        //   the first sample of every cell in Morton order, followed by the number of samples. Samples are then stored in
+        //   the Morton order of their cells, so those of a cell are contiguous.
+        // Everything is stored in the byte order of the host that wrote the file.
+        struct point_set_header {
+            char magic[4];               // "FPDS".
+            std::uint32_t version;
+            std::uint32_t byte_order;    // 'point_set_byte_order' as written by the host.
+            std::uint32_t dimensions;
+            std::uint64_t count;         // Number of samples.
+            std::uint64_t seed;
+            float r;
+            std::int32_t k;
+            float domain[8];             // Extent of the domain, along the first 'dimensions' axes.
+            std::uint32_t flags;
+            std::uint32_t index_bits;
+            std::uint64_t coordinates[8]; // Offset of the coordinate array of each axis.
+            std::uint64_t index;          // Offset of the spatial index, if 'flags' has 'point_set_indexed'.
+            std::uint8_t reserved[104];
+        };
+
+        static_assert(sizeof(point_set_header) == 256, "point set files start with a 256 byte header");
+
+        inline constexpr std::uint32_t point_set_version = 1;
+        inline constexpr std::uint32_t point_set_byte_order = 0x01020304;
+        inline constexpr std::uint32_t point_set_indexed = 1;
+
+        [[nodiscard]] constexpr std::uint64_t align_offset(std::uint64_t offset) {
+            return (offset + 63) & ~std::uint64_t { 63 };
+        }
+
+        // Unit of the buffer point set files are read into where they cannot be mapped, so that the arrays they hold
+        // keep the 64-byte alignment they have in the file.
+        struct alignas(64) point_set_block {
+            unsigned char bytes[64];
+        };
+
+        // Cell of the spatial index holding 'position', clamped to the lattice.
+        template <std::size_t N>
+        [[nodiscard]] cell<N> index_cell(const point<N>& position, const float* domain, unsigned bits) {
+            int cells = 1 << bits;
+            cell<N> result;
+            for (std::size_t i = 0; i < N; ++i) {
+                float coordinate = std::floor(position[i] / domain[i] * static_cast<float>(cells));
+                result[i] = static_cast<int>(std::clamp(coordinate, 0.0f, static_cast<float>(cells - 1)));
+            }
+            return result;
+        }
+
+        // Morton code of a cell of the spatial index, interleaving the bits of its coordinates.
+        template <std::size_t N>
+        [[nodiscard]] std::uint64_t interleave(const cell<N>& coordinates, unsigned bits) {
+            std::uint64_t code = 0;
+            for (unsigned bit = 0; bit < bits; ++bit) {
+                for (std::size_t i = 0; i < N; ++i) {
+                    code |= static_cast<std::uint64_t>((coordinates[i] >> bit) & 1) << (bit * N + i);
+                }
+            }
+            return code;
+        }
+
+        // Writes the 'count' samples given by 'sample(index)' to a point set file (see save_point_set).
+        template <std::size_t N, typename Sample>
+        bool write_point_set(const std::string& path, std::size_t count, Sample&& sample, const point_set_parameters<N>& parameters,
+                             bool spatial_index) {
+            static_assert(N >= 1 && N <= 8, "fpds point set files support between 1 and 8 dimensions");
+
+            point_set_header header { };
+            std::memcpy(header.magic, "FPDS", 4);
+            header.version = point_set_version;
+            header.byte_order = point_set_byte_order;
+            header.dimensions = static_cast<std::uint32_t>(N);
+            header.count = count;
+            header.seed = parameters.seed;
+            header.r = parameters.r;
+            header.k = parameters.k;
+            for (std::size_t i = 0; i < N; ++i) {
+                header.domain[i] = parameters.dimensions[i];
+                spatial_index = spatial_index && parameters.dimensions[i] > 0.0f;
+            }
+
+            // Samples are written in 'order', grouped by index cell through a counting sort if indexed.
+            std::vector<std::size_t> order(count);
+            std::vector<std::uint64_t> starts;
+
+            if (spatial_index) {
+                // About 16 samples per cell, within 2^24 cells.
+                unsigned bits = 0;
+                while (N * (bits + 1) <= 24 && (std::uint64_t { 16 } << (N * (bits + 1))) <= count) {
+                    ++bits;
+                }
+
+                header.flags |= point_set_indexed;
+                header.index_bits = bits;
+
+                std::vector<std::uint64_t> codes(count);
+                starts.assign((std::size_t { 1 } << (N * bits)) + 1, 0);
+                for (std::size_t index = 0; index < count; ++index) {
+                    codes[index] = interleave<N>(index_cell<N>(sample(index), header.domain, bits), bits);
+                    ++starts[codes[index] + 1];
+                }
+
+                for (std::size_t code = 1; code < starts.size(); ++code) {
+                    starts[code] += starts[code - 1];
+                }
+
+                std::vector<std::uint64_t> next(starts.begin(), starts.end() - 1);
+                for (std::size_t index = 0; index < count; ++index) {
+                    order[next[codes[index]]++] = index;
+                }
+            }
+            else {
+                for (std::size_t index = 0; index < count; ++index) {
+                    order[index] = index;
+                }
+            }
+
+            std::uint64_t offset = sizeof(point_set_header);
+            for (std::size_t i = 0; i < N; ++i) {
+                header.coordinates[i] = align_offset(offset);
+                offset = header.coordinates[i] + count * sizeof(float);
+            }
+            if (spatial_index) {
+                header.index = align_offset(offset);
+            }
+
+            std::ofstream file { path, std::ios::binary | std::ios::trunc };
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            offset = sizeof(header);
+
+            auto pad = [&](std::uint64_t target) {
+                static constexpr char zeros[64] = { };
+                file.write(zeros, static_cast<std::streamsize>(target - offset));
+                offset = target;
+            };
+
+            // Coordinates are gathered in blocks, so that each axis is written in few large writes.
+            std::vector<float> block;
+            block.reserve(std::min<std::size_t>(count, 65536));
+
+            for (std::size_t i = 0; i < N; ++i) {
+                pad(header.coordinates[i]);
+                for (std::size_t first = 0; first < count; first += block.capacity()) {
+                    std::size_t last = std::min(first + block.capacity(), count);
+
+                    block.clear();
+                    for (std::size_t index = first; index < last; ++index) {
+                        block.emplace_back(sample(order[index])[i]);
+                    }
+                    file.write(reinterpret_cast<const char*>(block.data()), static_cast<std::streamsize>(block.size() * sizeof(float)));
+                }
+                offset += count * sizeof(float);
+            }
+
+            if (spatial_index) {
+                pad(header.index);
+                file.write(reinterpret_cast<const char*>(starts.data()), static_cast<std::streamsize>(starts.size() * sizeof(std::uint64_t)));
+            }
+
+            file.close();
+            return !file.fail();
+        }
+
+    }
+
+    // Writes 'samples', and the parameters that generated them, to a point set file at 'path' (see point_set_file),
+    // replacing any existing file. Returns whether the file was written.
+    // 'spatial_index' - whether to store a spatial index, for box queries. Samples are then stored grouped by index cell
+    // (in Morton order) rather than in the given order. Requires the dimensions of the domain.
+    template <std::size_t N>
+    bool save_point_set(const std::string& path, const std::vector<point<N>>& samples, const point_set_parameters<N>& parameters,
+                        bool spatial_index = true) {
+        return detail::write_point_set<N>(path, samples.size(), [&](std::size_t index) -> const point<N>& {
+            return samples[index];
+        }, parameters, spatial_index);
+    }
+
+    // Overload for 2D samples.
+    inline bool save_point_set(const std::string& path, const std::vector<vec2>& samples, const point_set_parameters<2>& parameters,
+                               bool spatial_index = true) {
+        return detail::write_point_set<2>(path, samples.size(), [&](std::size_t index) {
+            return point<2> { samples[index].x, samples[index].y };
+        }, parameters, spatial_index);
+    }
+
+    // Overload for 3D samples.
+    inline bool save_point_set(const std::string& path, const std::vector<vec3>& samples, const point_set_parameters<3>& parameters,
+                               bool spatial_index = true) {
+        return detail::write_point_set<3>(path, samples.size(), [&](std::size_t index) {
+            return point<3> { samples[index].x, samples[index].y, samples[index].z };
+        }, parameters, spatial_index);
+    }
+
+    // Point set file opened for reading (see save_point_set). On POSIX systems the file is memory-mapped: opening takes
+    // constant time whatever its size, and coordinates are read in place, paged in as they are accessed. Elsewhere, the
+    // file is read into memory. Samples are exposed as one coordinate array per axis, without copies.
+    template <std::size_t N>
+    class point_set_file {
+        static_assert(N >= 1 && N <= 8, "fpds::point_set_file supports between 1 and 8 dimensions");
+
+        public:
+            // Opens the file at 'path'. Opening fails (see is_open) if the file cannot be read, is not a point set file
+            // of a supported version, was written with another byte order, holds samples of another dimension, or is
+            // truncated.
+            explicit point_set_file(const std::string& path) : data(nullptr), length(0), mapped(false) {
+#if FPDS_MMAP
+                int descriptor = ::open(path.c_str(), O_RDONLY);
+                if (descriptor < 0) {
+                    return;
+                }
+
+                struct stat status;
+                if (::fstat(descriptor, &status) == 0 && status.st_size > 0) {
+                    void* address = ::mmap(nullptr, static_cast<std::size_t>(status.st_size), PROT_READ, MAP_SHARED, descriptor, 0);
+                    if (address != MAP_FAILED) {
+                        data = static_cast<const unsigned char*>(address);
+                        length = static_cast<std::size_t>(status.st_size);
+                        mapped = true;
+                    }
+                }
+                ::close(descriptor);
+#else
+                std::ifstream file { path, std::ios::binary | std::ios::ate };
+                if (!file) {
+                    return;
+                }
+
+                length = static_cast<std::size_t>(file.tellg());
+                buffer.resize((length + sizeof(detail::point_set_block) - 1) / sizeof(detail::point_set_block));
+                file.seekg(0);
+                if (!file.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(length))) {
+                    length = 0;
+                    return;
+                }
+                data = reinterpret_cast<const unsigned char*>(buffer.data());
+#endif
+
+                if (!valid()) {
+                    close();
+                }
+            }
+
+            ~point_set_file() {
+                close();
+            }
+
+            point_set_file(const point_set_file&) = delete;
+            point_set_file& operator=(const point_set_file&) = delete;
+
+            point_set_file(point_set_file&& other) noexcept : data(nullptr), length(0), mapped(false) {
+                swap(other);
+            }
+
+            point_set_file& operator=(point_set_file&& other) noexcept {
+                point_set_file moved { std::move(other) };
+                swap(moved);
+                return *this;
+            }
+
+            [[nodiscard]] bool is_open() const {
+                return data != nullptr;
+            }
+
+            // Number of samples.
+            [[nodiscard]] std::size_t size() const {
+                return static_cast<std::size_t>(header().count);
+            }
+
+            [[nodiscard]] point_set_parameters<N> parameters() const {
+                point_set_parameters<N> result;
+                for (std::size_t i = 0; i < N; ++i) {
+                    result.dimensions[i] = header().domain[i];
+                }
+                result.r = header().r;
+                result.k = header().k;
+                result.seed = header().seed;
+                return result;
+            }
+
+            // Coordinates of every sample along 'axis' (size() values, 64-byte aligned).
+            [[nodiscard]] const float* coordinates(std::size_t axis) const {
+                return reinterpret_cast<const float*>(data + header().coordinates[axis]);
+            }
+
+            [[nodiscard]] point<N> operator[](std::size_t sample) const {
+                point<N> result;
+                for (std::size_t i = 0; i < N; ++i) {
+                    result[i] = coordinates(i)[sample];
+                }
+                return result;
+            }
+
+            [[nodiscard]] bool has_index() const {
+                return (header().flags & detail::point_set_indexed) != 0;
+            }
+
+            // Calls visit(sample) with the index of every sample inside the box [lower, upper). With a spatial index, only
+            // the samples of the index cells overlapping the box are read.
+            template <typename Visit>
+            void query(const point<N>& lower, const point<N>& upper, Visit&& visit) const {
+                auto test = [&](std::size_t sample) {
+                    for (std::size_t i = 0; i < N; ++i) {
+                        float coordinate = coordinates(i)[sample];
+                        if (!(coordinate >= lower[i] && coordinate < upper[i])) {
+                            return;
+                        }
+                    }
+                    visit(sample);
+                };
+
+                if (!has_index()) {
+                    for (std::size_t sample = 0; sample < size(); ++sample) {
+                        test(sample);
+                    }
+                    return;
+                }
+
+                for (std::size_t i = 0; i < N; ++i) {
+                    if (!(lower[i] < upper[i])) {
+                        return;
+                    }
+                }
+
+                unsigned bits = header().index_bits;
+                const std::uint64_t* starts = reinterpret_cast<const std::uint64_t*>(data + header().index);
+                cell<N> first = detail::index_cell<N>(lower, header().domain, bits);
+                cell<N> last = detail::index_cell<N>(upper, header().domain, bits);
+
+                cell<N> index_cell = first;
+                while (true) {
+                    // Cell ranges are clamped rather than checked on opening, which would read the whole index.
+                    std::uint64_t code = detail::interleave<N>(index_cell, bits);
+                    std::uint64_t end = std::min<std::uint64_t>(starts[code + 1], size());
+                    for (std::uint64_t sample = starts[code]; sample < end; ++sample) {
+                        test(static_cast<std::size_t>(sample));
+                    }
+
+                    // Next cell of the box, in row-major order.
+                    std::size_t axis = 0;
+                    while (axis < N && ++index_cell[axis] > last[axis]) {
+                        index_cell[axis] = first[axis];
+                        ++axis;
+                    }
+
+                    if (axis == N) {
+                        break;
+                    }
+                }
+            }
+
+        private:
+            [[nodiscard]] const detail::point_set_header& header() const {
+                return *reinterpret_cast<const detail::point_set_header*>(data);
+            }
+
+            // Returns whether the contents are a point set file of N-dimensional samples, with every array in bounds.
+            // Only the header is read.
+            [[nodiscard]] bool valid() const {
+                if (length < sizeof(detail::point_set_header)) {
+                    return false;
+                }
+
+                const detail::point_set_header& h = header();
+                if (std::memcmp(h.magic, "FPDS", 4) != 0 || h.version != detail::point_set_version ||
+                    h.byte_order != detail::point_set_byte_order || h.dimensions != N) {
+                    return false;
+                }
+
+                auto fits = [&](std::uint64_t offset, std::uint64_t count, std::uint64_t size) {
+                    return offset % size == 0 && offset <= length && count <= (length - offset) / size;
+                };
+
+                for (std::size_t i = 0; i < N; ++i) {
+                    if (!fits(h.coordinates[i], h.count, sizeof(float))) {
+                        return false;
+                    }
+                }
+
+                if (h.flags & detail::point_set_indexed) {
+                    if (N * h.index_bits > 24 || !fits(h.index, (std::uint64_t { 1 } << (N * h.index_bits)) + 1, sizeof(std::uint64_t))) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+            void close() {
+#if FPDS_MMAP
+                if (mapped) {
+                    ::munmap(const_cast<unsigned char*>(data), length);
+                }
+#endif
+                buffer.clear();
+                data = nullptr;
+                length = 0;
+                mapped = false;
+            }
+
+            void swap(point_set_file& other) noexcept {
+                std::swap(data, other.data);
+                std::swap(length, other.length);
+                std::swap(mapped, other.mapped);
+                std::swap(buffer, other.buffer);
+            }
+
+            const unsigned char* data;
+            std::size_t length;
+            bool mapped;                                 // Whether 'data' is a mapping of the file, rather than 'buffer'.
+            std::vector<detail::point_set_block> buffer; // Contents of the file, when it is read rather than mapped.
+    };
+
+}
@@ -0,0 +1,95 @@
+// Minimum distance test for fast_poisson_disk.
+// Every pair of samples must lie at least 'r' apart, and every sample inside the domain. Domains of 2 to 5 dimensions are
+// sampled with index and coordinate storage, under each instruction set the host supports, and the distance is
+// brute-forced over all pairs. Distances are compared in double precision with a small tolerance, as candidates are
+// tested in single precision. Exits with status 1 if any pair is too close or any sample is outside.
+
+#include "fpds.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <vector>
+
+namespace {
+
+    const char* name(fpds::simd_level level) {
+        switch (level) {
+            case fpds::simd_level::avx2:
+                return "avx2";
+            case fpds::simd_level::avx512:
+                return "avx512";
+            case fpds::simd_level::scalar:
+                break;
+        }
+        return "scalar";
+    }
+
+    // Returns the number of samples outside the domain and pairs closer than 'r'.
+    template <std::size_t N>
+    int check(const std::vector<fpds::point<N>>& points, const fpds::point<N>& dimensions, float r, double& minimum) {
+        int failures = 0;
+        minimum = std::numeric_limits<double>::infinity();
+
+        for (std::size_t a = 0; a < points.size(); ++a) {
+            for (std::size_t i = 0; i < N; ++i) {
+                failures += !(points[a][i] >= 0.0f && points[a][i] < dimensions[i]);
+            }
+            for (std::size_t b = a + 1; b < points.size(); ++b) {
+                double distance2 = 0.0;
+                for (std::size_t i = 0; i < N; ++i) {
+                    double delta = static_cast<double>(points[a][i]) - static_cast<double>(points[b][i]);
+                    distance2 += delta * delta;
+                }
+                double distance = std::sqrt(distance2);
+                failures += distance < r * (1.0 - 1e-5);
+                minimum = distance < minimum ? distance : minimum;
+            }
+        }
+        return failures;
+    }
+
+    template <std::size_t N, typename Storage>
+    int test(const char* storage, const fpds::point<N>& dimensions, float r, std::uint32_t seed) {
+        fpds::xoshiro128 generator { seed };
+        auto points = fpds::fast_poisson_disk<N, fpds::random_selection, Storage>(dimensions, r, 30, generator);
+
+        double minimum;
+        int failures = check<N>(points, dimensions, r, minimum);
+        std::printf("%zud %s %s: %zu points, minimum distance %.6f (r %.6f)%s\n", N, storage, name(fpds::active_simd_level()),
+                    points.size(), minimum, static_cast<double>(r), failures ? " (FAILED)" : "");
+        return failures + points.empty();
+    }
+
+    template <std::size_t N>
+    int test(const fpds::point<N>& dimensions, float r, std::uint32_t seed) {
+        return test<N, fpds::index_storage>("index", dimensions, r, seed)
+             + test<N, fpds::coordinate_storage>("coordinate", dimensions, r, seed);
+    }
+
+}
+
+int main() {
+    int failures = 0;
+
+    for (fpds::simd_level level : { fpds::simd_level::scalar, fpds::simd_level::avx2, fpds::simd_level::avx512 }) {
+        // Levels the host does not support run at a lower one, already covered.
+        fpds::limit_simd_level(level);
+        if (fpds::active_simd_level() != level) {
+            continue;
+        }
+
+        failures += test<2>({ 40.0f, 30.0f }, 1.0f, 1);
+        failures += test<2>({ 13.0f, 17.0f }, 0.37f, 2);
+        failures += test<3>({ 10.0f, 9.0f, 8.0f }, 1.0f, 3);
+        failures += test<4>({ 6.0f, 6.0f, 5.0f, 5.0f }, 1.0f, 4);
+        failures += test<5>({ 4.0f, 4.0f, 4.0f, 4.0f, 3.5f }, 1.0f, 5);
+    }
+
+    if (failures) {
+        std::printf("%d failures\n", failures);
+        return 1;
+    }
+    return 0;
+}
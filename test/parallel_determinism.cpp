@@ -0,0 +1,98 @@
+// Determinism test for the tiled parallel samplers.
+// fast_poisson_disk_parallel_2d/3d must generate the same points, in the same order, for any number of threads: the
+// tiling only depends on the grid, and every tile draws from its own generator stream. Each domain is sampled on a
+// range of thread counts (one, two, an odd count, and more threads than tiles), and the digests of the outputs are
+// compared against the single-threaded run. Exits with status 1 if any differs.
+
+#include "fpds.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+    // FNV-1a hash of the bit patterns of every coordinate, in output order.
+    template <typename Points>
+    std::uint64_t digest(const Points& points) {
+        std::uint64_t hash = 14695981039346656037ull;
+        for (const auto& point : points) {
+            const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&point);
+            for (std::size_t i = 0; i < sizeof(point); ++i) {
+                hash = (hash ^ bytes[i]) * 1099511628211ull;
+            }
+        }
+        return hash;
+    }
+
+    // Number of tiles the parallel sampler splits the domain into.
+    template <std::size_t N>
+    std::size_t tile_count(const fpds::point<N>& dimensions, float r) {
+        fpds::grid<N, fpds::coordinate_storage> g { dimensions, r };
+        return fpds::detail::tiling<N> { g.grid_dimensions }.size();
+    }
+
+    // Thread counts to compare: one, two, an odd count, and more threads than tiles.
+    std::vector<unsigned> thread_counts(std::size_t tiles) {
+        return { 1, 2, 7, static_cast<unsigned>(tiles) + 5 };
+    }
+
+    // Returns the number of thread counts whose output differs from the single-threaded one.
+    template <typename Sample>
+    int compare(const char* name, std::size_t tiles, Sample&& sample) {
+        int failures = 0;
+        std::uint64_t expected = 0;
+        std::size_t expected_points = 0;
+
+        for (unsigned threads : thread_counts(tiles)) {
+            auto points = sample(threads);
+            std::uint64_t actual = digest(points);
+
+            if (threads == 1) {
+                expected = actual;
+                expected_points = points.size();
+            }
+
+            bool match = actual == expected && points.size() == expected_points;
+            failures += !match;
+            std::printf("%s: %zu tiles, %u threads, %zu points, digest %016llx%s\n", name, tiles, threads, points.size(),
+                        static_cast<unsigned long long>(actual), match ? "" : " (MISMATCH)");
+        }
+        return failures;
+    }
+
+    template <typename Policy = fpds::random_selection>
+    int test_2d(const char* name, fpds::vec2 dimensions, float r, std::uint32_t seed) {
+        std::size_t tiles = tile_count<2>({ dimensions.x, dimensions.y }, r);
+        return compare(name, tiles, [&](unsigned threads) {
+            fpds::xoshiro128 generator { seed };
+            return fpds::fast_poisson_disk_parallel_2d<Policy>(dimensions, r, 30, generator, threads);
+        });
+    }
+
+    template <typename Policy = fpds::random_selection>
+    int test_3d(const char* name, fpds::vec3 dimensions, float r, std::uint32_t seed) {
+        std::size_t tiles = tile_count<3>({ dimensions.x, dimensions.y, dimensions.z }, r);
+        return compare(name, tiles, [&](unsigned threads) {
+            fpds::xoshiro128 generator { seed };
+            return fpds::fast_poisson_disk_parallel_3d<Policy>(dimensions, r, 30, generator, threads);
+        });
+    }
+
+}
+
+int main() {
+    int failures = 0;
+
+    failures += test_2d("2d", { 300.0f, 200.0f }, 1.0f, 1);
+    failures += test_2d("2d small", { 12.0f, 9.0f }, 1.0f, 2);
+    failures += test_2d<fpds::bucketed_selection>("2d bucketed", { 150.0f, 150.0f }, 1.0f, 3);
+    failures += test_3d("3d", { 24.0f, 20.0f, 16.0f }, 1.0f, 4);
+    failures += test_3d("3d small", { 5.0f, 5.0f, 4.0f }, 1.0f, 5);
+
+    if (failures) {
+        std::printf("%d mismatching runs\n", failures);
+        return 1;
+    }
+    return 0;
+}